@@ -0,0 +1,92 @@
+#include "../uxn/uxn.h"
+#include "../uxn/devices/screen.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* composes the largest screen uxn allows from random layers with each of the
+ * composers this machine has, the way screen_redraw does after a full screen
+ * change, and reports how many megapixels a second each manages. the output
+ * of every composer is checked against the scalar one */
+
+#define SECONDS 0.5
+#define SIZE 0x3ff /* screen_resize takes sizes below 0x400 */
+
+static UxnScreen scr;
+
+int
+emu_resize(UxnScreen *scr, int width, int height)
+{
+	return 1;
+}
+
+Uint32 *
+emu_lock(UxnScreen *scr, int x, int y, int width, int height, int *pitch)
+{
+	return NULL;
+}
+
+void
+emu_update(UxnScreen *scr, int x, int y, int width, int height)
+{
+}
+
+static double
+now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* the fastest of the redraws made in the time given */
+static double
+run(void)
+{
+	double start = now(), t, best = 1e9;
+
+	do {
+		screen_change(&scr, 0, 0, SIZE, SIZE);
+		t = now();
+		screen_redraw(&scr);
+		if ((t = now() - t) < best)
+			best = t;
+	} while (now() - start < SECONDS);
+	return (double)SIZE * SIZE / best;
+}
+
+int main(void) {
+	Uint8 palette[6] = {0x0f, 0x7a, 0xd6, 0x19, 0xc3, 0x5e};
+	Uint32 *expect;
+	char *name;
+	int i, n = SIZE * SIZE, failed = 0;
+
+	screen_resize(&scr, SIZE, SIZE);
+	if (scr.width != SIZE || !(expect = malloc(n * sizeof(Uint32)))) {
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+	screen_palette(&scr, palette);
+	srand(1);
+	for (i = 0; i < (n + 1) / 2; i++)
+		scr.layers[i] = rand();
+	/* the scalar composer is always the last one */
+	for (i = 0; screen_composer(i); i++)
+		;
+	screen_composer(i - 1);
+	screen_change(&scr, 0, 0, SIZE, SIZE);
+	screen_redraw(&scr);
+	memcpy(expect, scr.pixels, n * sizeof(Uint32));
+	printf("%-8s %14s\n", "composer", "Mpixels/s");
+	for (i = 0; (name = screen_composer(i)); i++) {
+		memset(scr.pixels, 0, n * sizeof(Uint32));
+		printf("%-8s %14.1f\n", name, run() / 1e6);
+		if (memcmp(scr.pixels, expect, n * sizeof(Uint32))) {
+			fprintf(stderr, "%s composed a different screen\n", name);
+			failed = 1;
+		}
+	}
+	free(expect);
+	return failed;
+}
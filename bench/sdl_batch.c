@@ -0,0 +1,120 @@
+#include "SDL_cosmo.h"
+#include <stdio.h>
+#include <time.h>
+
+/* draws the same frame of sprites through SDL_Renderer twice: once calling
+ * the shim for every sprite, once recording them into a batch and submitting
+ * it. a software renderer is used so no window or video driver is needed,
+ * which also means the native side does real work per sprite; the points
+ * pass, where the batch merges everything into one call, shows the most the
+ * shim overhead can matter */
+
+#define SPRITES 100000
+#define FRAMES 10
+#define WIDTH 640
+#define HEIGHT 480
+#define SPRITE 8
+
+static double
+now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void
+report(const char *name, double start, double end)
+{
+	printf("%-24s %8.2f ns/sprite\n", name, (end - start) * 1e9 / ((double)SPRITES * FRAMES));
+}
+
+static SDL_Rect
+place(int i)
+{
+	SDL_Rect r;
+	r.x = (unsigned)i * 7919 % (WIDTH - SPRITE);
+	r.y = (unsigned)i * 104729 % (HEIGHT - SPRITE);
+	r.w = r.h = SPRITE;
+	return r;
+}
+
+int main(void) {
+	SDL_Surface *target;
+	SDL_Renderer *renderer;
+	SDL_Texture *texture;
+	SDL_CosmoBatch *batch;
+	Uint32 pixels[SPRITE * SPRITE];
+	SDL_Rect r;
+	double start;
+	int i, frame;
+
+	if (SDL_CosmoInit() != 0) {
+		fprintf(stderr, "could not initialize cosmopolitan sdl: %s\n", SDL_CosmoGetError());
+		return 1;
+	}
+
+	target = SDL_CreateRGBSurfaceWithFormat(0, WIDTH, HEIGHT, 32, SDL_PIXELFORMAT_ARGB8888);
+	if (!target || !(renderer = SDL_CreateSoftwareRenderer(target))) {
+		fprintf(stderr, "could not create renderer: %s\n", SDL_GetError());
+		return 1;
+	}
+	texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC, SPRITE, SPRITE);
+	if (!texture || !(batch = SDL_CosmoBatchCreate())) {
+		fprintf(stderr, "could not create texture: %s\n", SDL_GetError());
+		return 1;
+	}
+	for (i = 0; i < SPRITE * SPRITE; i++)
+		pixels[i] = 0xff000000 | (i * 0x040404);
+	SDL_UpdateTexture(texture, NULL, pixels, SPRITE * sizeof(Uint32));
+
+	start = now();
+	for (frame = 0; frame < FRAMES; frame++) {
+		SDL_RenderClear(renderer);
+		for (i = 0; i < SPRITES; i++) {
+			r = place(i);
+			SDL_RenderCopy(renderer, texture, NULL, &r);
+		}
+		SDL_RenderPresent(renderer);
+	}
+	report("SDL_RenderCopy direct", start, now());
+
+	start = now();
+	for (frame = 0; frame < FRAMES; frame++) {
+		SDL_CosmoBatchRenderClear(batch, renderer);
+		for (i = 0; i < SPRITES; i++) {
+			r = place(i);
+			SDL_CosmoBatchRenderCopy(batch, renderer, texture, NULL, &r);
+		}
+		SDL_CosmoBatchSubmit(batch);
+		SDL_RenderPresent(renderer);
+	}
+	report("SDL_RenderCopy batched", start, now());
+
+	start = now();
+	for (frame = 0; frame < FRAMES; frame++) {
+		for (i = 0; i < SPRITES; i++) {
+			r = place(i);
+			SDL_RenderDrawPoint(renderer, r.x, r.y);
+		}
+		SDL_RenderPresent(renderer);
+	}
+	report("SDL_RenderDrawPoint direct", start, now());
+
+	start = now();
+	for (frame = 0; frame < FRAMES; frame++) {
+		for (i = 0; i < SPRITES; i++) {
+			r = place(i);
+			SDL_CosmoBatchRenderDrawPoint(batch, renderer, r.x, r.y);
+		}
+		SDL_CosmoBatchSubmit(batch);
+		SDL_RenderPresent(renderer);
+	}
+	report("SDL_RenderDrawPoint batched", start, now());
+
+	SDL_CosmoBatchDestroy(batch);
+	SDL_DestroyTexture(texture);
+	SDL_DestroyRenderer(renderer);
+	SDL_FreeSurface(target);
+	return 0;
+}
@@ -0,0 +1,52 @@
+#include "SDL_cosmo.h"
+#include <stdio.h>
+#include <time.h>
+
+/* measures the overhead of a call through the SDL shim. the procedures
+ * picked here do next to no work on the native side, so the figures are
+ * dominated by the cost of crossing the jump table. */
+
+#define ITERATIONS 10000000
+
+static double
+now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void
+report(const char *name, double start, double end)
+{
+	printf("%-24s %8.2f ns/call\n", name, (end - start) * 1e9 / ITERATIONS);
+}
+
+int main(void) {
+	SDL_Rect a = { 0, 0, 16, 16 }, b = { 8, 8, 16, 16 };
+	volatile int sink = 0;
+	double start;
+	int i;
+
+	if (SDL_CosmoInit() != 0) {
+		fprintf(stderr, "could not initialize cosmopolitan sdl: %s\n", SDL_CosmoGetError());
+		return 1;
+	}
+
+	start = now();
+	for (i = 0; i < ITERATIONS; i++)
+		sink += SDL_GetRevisionNumber();
+	report("SDL_GetRevisionNumber", start, now());
+
+	start = now();
+	for (i = 0; i < ITERATIONS; i++)
+		sink += SDL_abs(i);
+	report("SDL_abs", start, now());
+
+	start = now();
+	for (i = 0; i < ITERATIONS; i++)
+		sink += SDL_HasIntersection(&a, &b);
+	report("SDL_HasIntersection", start, now());
+
+	return 0;
+}
@@ -0,0 +1,310 @@
+#include "SDL_cosmo.h"
+#include "SDL_syswm.h"
+#include "SDL_vulkan.h"
+#include "SDL_cosmo_trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/mman.h>
+
+/* drives the native library from a trace recorded by a shim built with
+ * SDL_COSMO_TRACE, then lists the slowest frames as recorded and as
+ * replayed. the dummy video and audio drivers are used unless told
+ * otherwise through the environment.
+ *
+ * pointers returned by a traced call are remembered, and later calls
+ * passing the recorded pointer get the one returned on replay instead.
+ * strings and the structures the trace keeps are handed over as recorded,
+ * any other pointer gets a zeroed scratch buffer. procedures taking
+ * callbacks, or that can't be replayed with made up pointers, are skipped.
+ * threads are replayed in the order their calls were recorded */
+
+#define MAX_ARGS 12
+#define SCRATCH_SIZE (16 << 20)
+#define HANDLES (1 << 16)
+
+struct call {
+	const struct trace_record *rec;
+	const struct trace_arg *arg[MAX_ARGS];
+	unsigned char slot[MAX_ARGS][32] __attribute__((aligned(16)));
+};
+
+struct frame {
+	long long recorded, replayed;
+	long index;
+};
+
+static unsigned char *scratch;
+static struct {
+	Uint64 recorded;
+	void *live;
+} handles[HANDLES];
+
+static const char *const skipped[] = {
+	"SDL_AddTimer", "SDL_RemoveTimer", "SDL_CreateThread",
+	"SDL_CreateThreadWithStackSize", "SDL_WaitThread", "SDL_DetachThread",
+	"SDL_SetEventFilter", "SDL_GetEventFilter", "SDL_AddEventWatch",
+	"SDL_DelEventWatch", "SDL_FilterEvents", "SDL_AddHintCallback",
+	"SDL_DelHintCallback", "SDL_LogSetOutputFunction", "SDL_LogGetOutputFunction",
+	"SDL_OpenAudio", "SDL_OpenAudioDevice", "SDL_SetAssertionHandler",
+	"SDL_SetMemoryFunctions", "SDL_GetMemoryFunctions", "SDL_SetWindowHitTest",
+	"SDL_LogMessageV", "SDL_vsnprintf", "SDL_vsscanf", "SDL_qsort",
+	"SDL_free", "SDL_realloc", "SDL_GL_GetProcAddress",
+	NULL
+};
+
+static const char *const presents[] = {
+	"SDL_RenderPresent", "SDL_GL_SwapWindow", "SDL_UpdateWindowSurface",
+	NULL
+};
+
+static long long
+now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ll + ts.tv_nsec;
+}
+
+static int
+listed(const char *const *list, const char *name)
+{
+	for (; *list; list++)
+		if (!strcmp(*list, name))
+			return 1;
+	return 0;
+}
+
+static void **
+handle(Uint64 recorded)
+{
+	unsigned i = (recorded >> 4) * 0x9e3779b1u;
+	for (;; i++) {
+		i &= HANDLES - 1;
+		if (!handles[i].recorded || handles[i].recorded == recorded) {
+			handles[i].recorded = recorded;
+			return &handles[i].live;
+		}
+	}
+}
+
+static const void *
+replay_arg(struct call *call, int i)
+{
+	const struct trace_arg *arg = call->arg[i];
+	const unsigned char *data = (const unsigned char *)(arg + 1);
+	unsigned char *buf = scratch + (size_t)i * SCRATCH_SIZE;
+	Uint64 recorded;
+	void *p = NULL;
+
+	memset(call->slot[i], 0, sizeof(call->slot[i]));
+	switch (arg->kind) {
+	case SDL_COSMO_TRACE_VALUE:
+		memcpy(call->slot[i], data, arg->size < 32 ? arg->size : 32);
+		return call->slot[i];
+	case SDL_COSMO_TRACE_POINTER:
+		memcpy(&recorded, data, sizeof(recorded));
+		if (!(p = *handle(recorded)))
+			p = buf;
+		break;
+	case SDL_COSMO_TRACE_STRING: /* skip the digest */
+		memcpy(buf, data + 8, arg->size - 8);
+		p = buf;
+		break;
+	case SDL_COSMO_TRACE_DATA:
+		memcpy(buf, data, arg->size);
+		p = buf;
+		break;
+	}
+	memcpy(call->slot[i], &p, sizeof(p));
+	return call->slot[i];
+}
+
+static void
+replay_result(struct call *call, const void *ret, size_t size)
+{
+	void *p;
+	if (call->rec->ret_kind != SDL_COSMO_TRACE_POINTER || !call->rec->ret)
+		return;
+	memcpy(&p, ret, sizeof(p));
+	*handle(call->rec->ret) = p;
+}
+
+/* the shim doesn't provide these, they are skipped anyway */
+#define SDL_SetAssertionHandler(...) ((void)0)
+#define SDL_SetMemoryFunctions(...) (-1)
+#define SDL_SetWindowHitTest(...) (-1)
+#define SDL_OpenAudio(...) (-1)
+
+#define REPLAY_ARG(params, i, a) \
+	SDL_COSMO_TRACE_NTH(i, params); \
+	memcpy((void *)&a, replay_arg(call, i), sizeof(a));
+#define REPLAY_RET_return(call, expr) { \
+	__typeof__(expr) r_ = expr; \
+	replay_result(call, &r_, sizeof(r_)); \
+}
+#define REPLAY_RET_(call, expr) expr;
+
+#define SDL_DYNAPI_PROC(rc, fn, params, args, ret) \
+	static void replay_##fn(struct call *call) { \
+		SDL_COSMO_TRACE_EACH(REPLAY_ARG, params, args) \
+		REPLAY_RET_##ret(call, fn args) \
+	}
+#define SDL_DYNAPI_PROC_NO_VARARGS 1
+#include "SDL_dynapi_procs.inc"
+#undef SDL_DYNAPI_PROC
+#undef SDL_DYNAPI_PROC_NO_VARARGS
+
+static const struct {
+	const char *name;
+	void (*replay)(struct call *);
+} procs[] = {
+#define SDL_DYNAPI_PROC(rc, fn, params, args, ret) { #fn, replay_##fn },
+#define SDL_DYNAPI_PROC_NO_VARARGS 1
+#include "SDL_dynapi_procs.inc"
+#undef SDL_DYNAPI_PROC
+#undef SDL_DYNAPI_PROC_NO_VARARGS
+};
+
+static int
+slowest(const void *a, const void *b)
+{
+	const struct frame *x = a, *y = b;
+	return (x->recorded < y->recorded) - (x->recorded > y->recorded);
+}
+
+static unsigned char *
+load(const char *path, size_t *size)
+{
+	FILE *f = fopen(path, "rb");
+	unsigned char *buf = NULL;
+	size_t cap = 0, n;
+	*size = 0;
+	if (!f)
+		return NULL;
+	for (;;) {
+		if (*size == cap && !(buf = realloc(buf, cap = cap ? cap * 2 : 1 << 20)))
+			break;
+		if (!(n = fread(buf + *size, 1, cap - *size, f)))
+			break;
+		*size += n;
+	}
+	fclose(f);
+	return buf;
+}
+
+static void
+usage(const char *prog)
+{
+	fprintf(stderr, "usage: %s [-p] [-n frames] trace\n"
+		"  -p         keep the pace of the recording\n"
+		"  -n frames  how many of the slowest frames to list (10)\n", prog);
+	exit(1);
+}
+
+int main(int argc, char **argv) {
+	const struct trace_header *hdr;
+	const struct trace_record *rec;
+	void (**replay)(struct call *);
+	char *is_present;
+	const char *name;
+	unsigned char *trace, *p, *q, *end;
+	struct frame *frames = NULL;
+	long nframes = 0, cap = 0, calls = 0, skips = 0;
+	long long start, t, recorded_mark = 0, replayed_mark;
+	size_t size;
+	struct call call;
+	int pace = 0, top = 10, i, j, k;
+
+	for (i = 1; i < argc && argv[i][0] == '-'; i++) {
+		if (!strcmp(argv[i], "-p"))
+			pace = 1;
+		else if (!strcmp(argv[i], "-n") && i + 1 < argc)
+			top = atoi(argv[++i]);
+		else
+			usage(argv[0]);
+	}
+	if (i != argc - 1)
+		usage(argv[0]);
+
+	if (!(trace = load(argv[i], &size)) || size < sizeof(*hdr)) {
+		fprintf(stderr, "could not read %s\n", argv[i]);
+		return 1;
+	}
+	hdr = (const struct trace_header *)trace;
+	if (memcmp(hdr->magic, SDL_COSMO_TRACE_MAGIC, 8) || hdr->version != SDL_COSMO_TRACE_VERSION) {
+		fprintf(stderr, "%s is not an sdl call trace\n", argv[i]);
+		return 1;
+	}
+
+	/* the trace names its procedures, match them up with ours */
+	replay = calloc(hdr->procs, sizeof(*replay));
+	is_present = calloc(hdr->procs, 1);
+	p = trace + sizeof(*hdr);
+	end = trace + size;
+	for (j = 0; j < (int)hdr->procs && p < end; j++) {
+		name = (const char *)p;
+		p += strlen(name) + 1;
+		is_present[j] = listed(presents, name);
+		if (listed(skipped, name))
+			continue;
+		for (k = 0; k < (int)(sizeof(procs) / sizeof(*procs)); k++)
+			if (!strcmp(procs[k].name, name))
+				replay[j] = procs[k].replay;
+	}
+	p = trace + SDL_COSMO_TRACE_ALIGN(p - trace, 8);
+
+	setenv("SDL_VIDEODRIVER", "dummy", 0);
+	setenv("SDL_AUDIODRIVER", "dummy", 0);
+	scratch = mmap(NULL, (size_t)MAX_ARGS * SCRATCH_SIZE, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (scratch == MAP_FAILED) {
+		fprintf(stderr, "could not map scratch buffers\n");
+		return 1;
+	}
+	if (SDL_CosmoInit() != 0) {
+		fprintf(stderr, "could not initialize cosmopolitan sdl: %s\n", SDL_CosmoGetError());
+		return 1;
+	}
+
+	start = replayed_mark = now();
+	for (; p + sizeof(*rec) <= end; p += rec->size) {
+		rec = (const struct trace_record *)p;
+		if (rec->size < sizeof(*rec) || p + rec->size > end)
+			break;
+		if (rec->proc >= hdr->procs || !replay[rec->proc] || rec->args > MAX_ARGS) {
+			skips++;
+			continue;
+		}
+		call.rec = rec;
+		for (j = 0, q = p + sizeof(*rec); j < rec->args; j++) {
+			call.arg[j] = (const struct trace_arg *)q;
+			q += SDL_COSMO_TRACE_ALIGN(sizeof(struct trace_arg) + call.arg[j]->size, 4);
+		}
+		if (pace)
+			while ((t = now() - start) < (long long)rec->start)
+				SDL_Delay((rec->start - t) / 1000000);
+		replay[rec->proc](&call);
+		calls++;
+		if (is_present[rec->proc]) {
+			if (nframes == cap && !(frames = realloc(frames, (cap = cap ? cap * 2 : 1024) * sizeof(*frames))))
+				return 1;
+			t = now();
+			frames[nframes].index = nframes;
+			frames[nframes].recorded = rec->start + rec->duration - recorded_mark;
+			frames[nframes].replayed = t - replayed_mark;
+			recorded_mark = rec->start + rec->duration;
+			replayed_mark = t;
+			nframes++;
+		}
+	}
+
+	printf("replayed %ld calls in %.2f ms, skipped %ld\n", calls, (now() - start) / 1e6, skips);
+	qsort(frames, nframes, sizeof(*frames), slowest);
+	printf("%-10s %14s %14s\n", "frame", "recorded ms", "replayed ms");
+	for (i = 0; i < nframes && i < top; i++)
+		printf("%-10ld %14.3f %14.3f\n", frames[i].index,
+			frames[i].recorded / 1e6, frames[i].replayed / 1e6);
+	return 0;
+}
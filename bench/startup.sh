@@ -0,0 +1,27 @@
+#!/bin/sh
+# compares the time spent binding native SDL procedures at startup, with
+# everything resolved up front (SDL_COSMO_BIND_NOW=1) against the default
+# of binding each procedure on first use. each example runs for a few
+# seconds against the dummy drivers, then gets asked to quit.
+#
+# usage: bench/startup.sh [file.rom]
+
+ROM=${1:-launcher.rom}
+SECONDS_PER_RUN=3
+
+export SDL_VIDEODRIVER=dummy SDL_AUDIODRIVER=dummy
+
+run() {
+	name=$1
+	shift
+	for mode in now lazy; do
+		if [ $mode = now ]; then bind_now=1; else bind_now=; fi
+		result=$(SDL_COSMO_BIND_NOW=$bind_now timeout -s INT $SECONDS_PER_RUN "$@" 2>&1 >/dev/null |
+			grep -o 'bound [0-9]* procedures.*' | tail -n 1)
+		printf '%-20s %-5s %s\n' "$name" "$mode" "${result:-no binding diagnostics}"
+	done
+}
+
+run imgui_example o/imgui_example.com
+run oggplay_example o/oggplay_example.com oggplay/Fender_Rhodes_VSTi_with_stereo_phaser_VST.ogg
+run uxnemu o/uxnemu.com "$ROM"
@@ -0,0 +1,113 @@
+#include "../uxn/uxn.h"
+#include "uxn_roms.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+/* runs the benchmark roms through the switch, threaded and translating
+ * evaluators, all built from uxn/uxn.c under different names, and reports
+ * how many instructions per second each manages. with -w dir, writes the
+ * roms out instead, for running them through uxncli */
+
+#define SECONDS 0.5
+
+int uxn_boot_switch(Uxn *u, Uint8 *ram);
+int uxn_eval_switch(Uxn *u, Uint16 pc);
+int uxn_eval_threaded(Uxn *u, Uint16 pc);
+int uxn_eval_blocks(Uxn *u, Uint16 pc);
+void uxn_invalidate_blocks(Uxn *u, Uint16 addr, Uint32 len);
+void uxn_free_blocks(Uxn *u);
+
+static Uint8 ram[0x10000];
+
+Uint8
+emu_dei(Uxn *u, Uint8 addr)
+{
+	return u->dev[addr];
+}
+
+void
+emu_deo(Uxn *u, Uint8 addr)
+{
+}
+
+int
+emu_halt(Uxn *u, Uint8 instr, Uint8 err, Uint16 addr)
+{
+	fprintf(stderr, "halted: %02x error %d at %04x\n", instr, err, addr);
+	return 0;
+}
+
+static double
+now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* the fastest of the runs made in the time given, which is the one the
+ * least disturbed by whatever else the machine was doing */
+static double
+run(const struct bench_rom *rom, int (*eval)(Uxn *, Uint16))
+{
+	double start = now(), t, best = 1e9;
+	void *cache = NULL;
+	Uxn u;
+
+	do {
+		memset(ram, 0, sizeof(ram));
+		memcpy(ram + PAGE_PROGRAM, rom->code, rom->size);
+		/* the blocks engine keeps its cache from one run to the next,
+		 * emptied, so that allocating it is not timed */
+		uxn_boot_switch(&u, ram);
+		u.cache = cache;
+		uxn_invalidate_blocks(&u, 0, 0x10000);
+		t = now();
+		if (!eval(&u, PAGE_PROGRAM) || u.wst.ptr || u.rst.ptr) {
+			fprintf(stderr, "%s did not run to completion\n", rom->name);
+			uxn_free_blocks(&u);
+			return 0;
+		}
+		cache = u.cache;
+		if ((t = now() - t) < best)
+			best = t;
+	} while (now() - start < SECONDS);
+	uxn_free_blocks(&u);
+	return rom->instructions / best;
+}
+
+
+static int
+write_roms(const char *dir)
+{
+	char path[4096];
+	FILE *f;
+	size_t i;
+
+	for (i = 0; i < sizeof(bench_roms) / sizeof(*bench_roms); i++) {
+		snprintf(path, sizeof(path), "%s/%s.rom", dir, bench_roms[i].name);
+		if (!(f = fopen(path, "wb")) || fwrite(bench_roms[i].code, bench_roms[i].size, 1, f) != 1) {
+			fprintf(stderr, "could not write %s\n", path);
+			return 1;
+		}
+		fclose(f);
+	}
+	return 0;
+}
+
+int main(int argc, char **argv) {
+	double sw, th, bl;
+	size_t i;
+
+	if (argc == 3 && !strcmp(argv[1], "-w"))
+		return write_roms(argv[2]);
+	printf("%-8s %14s %14s %14s\n", "rom", "switch MIPS", "threaded MIPS", "blocks MIPS");
+	for (i = 0; i < sizeof(bench_roms) / sizeof(*bench_roms); i++) {
+		sw = run(&bench_roms[i], uxn_eval_switch);
+		th = run(&bench_roms[i], uxn_eval_threaded);
+		bl = run(&bench_roms[i], uxn_eval_blocks);
+		printf("%-8s %14.1f %14.1f %14.1f\n", bench_roms[i].name, sw / 1e6, th / 1e6, bl / 1e6);
+	}
+	return 0;
+}
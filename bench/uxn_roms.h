@@ -0,0 +1,101 @@
+/* roms for the interpreter benchmarks, assembled by hand from the tal
+ * source in the comments. each one runs straight through to BRK without
+ * touching any device, leaving both stacks empty. instructions is how many
+ * the rom executes, as counted by running it */
+
+struct bench_rom {
+	const char *name;
+	unsigned long instructions;
+	unsigned long size;
+	const unsigned char *code;
+};
+
+/*
+|0100
+	#0018 fib POP2 BRK
+@fib ( n* -- fib* )
+	DUP2 #0002 LTH2 ?&base
+	DUP2 #0001 SUB2 fib
+	SWP2 #0002 SUB2 fib
+	ADD2 JMP2r
+	&base JMP2r
+*/
+static const unsigned char rom_fib[] = {
+	0xa0, 0x00, 0x18, 0x60, 0x00, 0x02, 0x22, 0x00, 0x26, 0xa0, 0x00, 0x02,
+	0x2b, 0x20, 0x00, 0x12, 0x26, 0xa0, 0x00, 0x01, 0x39, 0x60, 0xff, 0xf0,
+	0x24, 0xa0, 0x00, 0x02, 0x39, 0x60, 0xff, 0xe8, 0x38, 0x6c, 0x6c};
+
+/*
+|0100
+	#0040 &outer
+		#0000 &inner
+			INC2 DUP2 #4000 NEQ2 ?&inner
+		POP2
+		#0001 SUB2 DUP2 #0000 NEQ2 ?&outer
+	POP2 BRK
+*/
+static const unsigned char rom_loop[] = {
+	0xa0, 0x00, 0x40, 0xa0, 0x00, 0x00, 0x21, 0x26, 0xa0, 0x40, 0x00, 0x29,
+	0x20, 0xff, 0xf7, 0x22, 0xa0, 0x00, 0x01, 0x39, 0x26, 0xa0, 0x00, 0x00,
+	0x29, 0x20, 0xff, 0xe7, 0x22, 0x00};
+
+/*
+|0100
+	#0040 &rep
+		#0000 &copy
+			DUP2 #4000 ADD2 OVR2 #2000 ADD2 LDA ROT ROT STA
+			INC2 DUP2 #1000 NEQ2 ?&copy
+		POP2
+		#0001 SUB2 DUP2 #0000 NEQ2 ?&rep
+	POP2 BRK
+*/
+static const unsigned char rom_copy[] = {
+	0xa0, 0x00, 0x40, 0xa0, 0x00, 0x00, 0x26, 0xa0, 0x40, 0x00, 0x38, 0x27,
+	0xa0, 0x20, 0x00, 0x38, 0x14, 0x05, 0x05, 0x15, 0x21, 0x26, 0xa0, 0x10,
+	0x00, 0x29, 0x20, 0xff, 0xe9, 0x22, 0xa0, 0x00, 0x01, 0x39, 0x26, 0xa0,
+	0x00, 0x00, 0x29, 0x20, 0xff, 0xd9, 0x22, 0x00};
+
+/*
+|0100
+	#0001 #0002 #0003 #0000 &loop
+		STH2 ADD2k NIP2 SWP2 ROT2k POP2 POP2 POP2 STH2r
+		INC2 DUP2 #8000 NEQ2 ?&loop
+	POP2 POP2 POP2 POP2 BRK
+*/
+static const unsigned char rom_stack[] = {
+	0xa0, 0x00, 0x01, 0xa0, 0x00, 0x02, 0xa0, 0x00, 0x03, 0xa0, 0x00, 0x00,
+	0x2f, 0xb8, 0x23, 0x24, 0xa5, 0x22, 0x22, 0x22, 0x6f, 0x21, 0x26, 0xa0,
+	0x80, 0x00, 0x29, 0x20, 0xff, 0xee, 0x22, 0x22, 0x22, 0x22, 0x00};
+
+/* counts the primes below 0x4000 by trial division
+|0100
+	#0000 #0002 ( count n )
+	&loop
+		DUP2 is-prime ?&yes !&next
+		&yes SWP2 INC2 SWP2
+		&next INC2 DUP2 #4000 NEQ2 ?&loop
+	POP2 POP2 BRK
+@is-prime ( n* -- f )
+	STH2 #0002
+	&loop ( d )
+		DUP2 DUP2 MUL2 STH2kr GTH2 ?&prime
+		STH2kr OVR2 DIV2k MUL2 EQU2 ?&composite
+		INC2 !&loop
+	&prime POP2 POP2r #01 JMP2r
+	&composite POP2 POP2r #00 JMP2r
+*/
+static const unsigned char rom_primes[] = {
+	0xa0, 0x00, 0x00, 0xa0, 0x00, 0x02, 0x26, 0x60, 0x00, 0x15, 0x20, 0x00,
+	0x03, 0x40, 0x00, 0x03, 0x24, 0x21, 0x24, 0x21, 0x26, 0xa0, 0x40, 0x00,
+	0x29, 0x20, 0xff, 0xea, 0x22, 0x22, 0x00, 0x2f, 0xa0, 0x00, 0x02, 0x26,
+	0x26, 0x3a, 0xef, 0x2a, 0x20, 0x00, 0x0c, 0xef, 0x27, 0xbb, 0x3a, 0x28,
+	0x20, 0x00, 0x09, 0x21, 0x40, 0xff, 0xec, 0x22, 0x62, 0x80, 0x01, 0x6c,
+	0x22, 0x62, 0x80, 0x00, 0x6c};
+
+static const struct bench_rom bench_roms[] = {
+	{"fib", 1425465, sizeof(rom_fib), rom_fib},
+	{"loop", 5243395, sizeof(rom_loop), rom_loop},
+	{"copy", 3932675, sizeof(rom_copy), rom_copy},
+	{"stack", 458761, sizeof(rom_stack), rom_stack},
+	{"primes", 3451341, sizeof(rom_primes), rom_primes},
+};
@@ -186,14 +186,15 @@ GL3W_API void gl3wInit(void);
     write(f, r'''	} ms;
 };
 
+/* always called with the sysv calling convention. on windows, gl3wInit
+ * points these at thunks into the native ms_abi procedures */
 GL3W_API extern union GL3WProcs gl3wProcs;
 
 /* OpenGL functions */
 ''')
     for proc in procs:
         write(f, 'static {0}{1}{2}\n'.format(*proc))
-        write(f, '{{ if (IsWindows()) {4}   gl3wProcs.ms.{1}{3};\n'.format(*proc))
-        write(f, '  else             {4} gl3wProcs.sysv.{1}{3}; }}\n\n'.format(*proc))
+        write(f, '{{ {4} gl3wProcs.sysv.{1}{3}; }}\n\n'.format(*proc))
     write(f, r'''
 #ifdef __cplusplus
 }
@@ -209,6 +210,7 @@ with open(os.path.join(args.root, 'gl3w.c'), 'wb') as f:
     write(f, r'''#include <GL/gl3w.h>
 #include "SDL.h"
 #include "libc/dlopen/dlfcn.h"
+#include "libc/isystem/stdlib.h"
 
 static const char *proc_names[] = {
 ''')
@@ -218,13 +220,48 @@ static const char *proc_names[] = {
 
 GL3W_API union GL3WProcs gl3wProcs;
 
+static union GL3WProcs native_procs;
+
+''')
+    for proc in procs:
+        write(f, 'static {0}{1}_ms{2}\n'.format(*proc))
+        write(f, '{{ {4} native_procs.ms.{1}{3}; }}\n\n'.format(*proc))
+    write(f, 'static void *ms_thunks[] = {\n')
+    for proc in procs:
+        write(f, '\t(void *){0}_ms,\n'.format(proc[1]))
+    write(f, r'''};
+
+/* resolves a procedure and installs the variant for the host's calling
+ * convention into gl3wProcs */
+static void gl3wBindProc(size_t i)
+{
+	void *native = SDL_GL_GetProcAddress(proc_names[i]);
+
+	__atomic_store_n(&native_procs.ptr[i], native, __ATOMIC_RELEASE);
+	__atomic_store_n(&gl3wProcs.ptr[i],
+		IsWindows() ? ms_thunks[i] : cosmo_dltramp(native), __ATOMIC_RELEASE);
+}
+
+/* resolver stubs, installed into gl3wProcs when binding lazily */
+''')
+    for i, proc in enumerate(procs):
+        write(f, 'static {0}{1}_lazy{2}\n'.format(*proc))
+        write(f, '{{ gl3wBindProc({5}); {4} gl3wProcs.sysv.{1}{3}; }}\n\n'.format(*(proc + (i,))))
+    write(f, 'static void *lazy_stubs[] = {\n')
+    for proc in procs:
+        write(f, '\t(void *){0}_lazy,\n'.format(proc[1]))
+    write(f, r'''};
+
+/* procedures are resolved on first call, unless SDL_COSMO_BIND_NOW asks for
+ * everything up front like it does for SDL itself */
 void gl3wInit(void)
 {
+	const char *bind_now = getenv("SDL_COSMO_BIND_NOW");
 	size_t i;
 
 	for (i = 0; i < sizeof(proc_names)/sizeof(proc_names[0]); i++) {
-		gl3wProcs.ptr[i] = SDL_GL_GetProcAddress(proc_names[i]);
-        if (!IsWindows()) gl3wProcs.ptr[i] = cosmo_dltramp(gl3wProcs.ptr[i]);
-    }
+		if (bind_now && *bind_now) gl3wBindProc(i);
+		else gl3wProcs.ptr[i] = lazy_stubs[i];
+	}
 }
 ''')
@@ -10,6 +10,44 @@ extern "C" {
 int SDL_CosmoInit(void);
 const char *SDL_CosmoGetError(void);
 
+/* prints per procedure call counts and latencies to stderr. only does
+ * anything when built with SDL_COSMO_STATS, where it also runs at exit */
+void SDL_CosmoDumpStats(void);
+
+/* records render calls to be replayed later by SDL_CosmoBatchSubmit, which
+ * merges runs of points and rects into single calls. pointers passed to
+ * SDL_CosmoBatchUpdateTexture must stay valid until the batch is submitted */
+typedef struct SDL_CosmoBatch SDL_CosmoBatch;
+
+SDL_CosmoBatch *SDL_CosmoBatchCreate(void);
+void SDL_CosmoBatchDestroy(SDL_CosmoBatch *batch);
+void SDL_CosmoBatchBegin(SDL_CosmoBatch *batch);
+int SDL_CosmoBatchSubmit(SDL_CosmoBatch *batch);
+
+int SDL_CosmoBatchSetRenderDrawColor(SDL_CosmoBatch *batch, SDL_Renderer *renderer,
+                                     Uint8 r, Uint8 g, Uint8 b, Uint8 a);
+int SDL_CosmoBatchRenderClear(SDL_CosmoBatch *batch, SDL_Renderer *renderer);
+int SDL_CosmoBatchRenderCopy(SDL_CosmoBatch *batch, SDL_Renderer *renderer, SDL_Texture *texture,
+                             const SDL_Rect *srcrect, const SDL_Rect *dstrect);
+int SDL_CosmoBatchRenderCopyEx(SDL_CosmoBatch *batch, SDL_Renderer *renderer, SDL_Texture *texture,
+                               const SDL_Rect *srcrect, const SDL_Rect *dstrect,
+                               double angle, const SDL_Point *center, SDL_RendererFlip flip);
+int SDL_CosmoBatchRenderDrawPoint(SDL_CosmoBatch *batch, SDL_Renderer *renderer, int x, int y);
+int SDL_CosmoBatchRenderDrawPoints(SDL_CosmoBatch *batch, SDL_Renderer *renderer,
+                                   const SDL_Point *points, int count);
+int SDL_CosmoBatchRenderDrawLine(SDL_CosmoBatch *batch, SDL_Renderer *renderer,
+                                 int x1, int y1, int x2, int y2);
+int SDL_CosmoBatchRenderDrawRect(SDL_CosmoBatch *batch, SDL_Renderer *renderer,
+                                 const SDL_Rect *rect);
+int SDL_CosmoBatchRenderDrawRects(SDL_CosmoBatch *batch, SDL_Renderer *renderer,
+                                  const SDL_Rect *rects, int count);
+int SDL_CosmoBatchRenderFillRect(SDL_CosmoBatch *batch, SDL_Renderer *renderer,
+                                 const SDL_Rect *rect);
+int SDL_CosmoBatchRenderFillRects(SDL_CosmoBatch *batch, SDL_Renderer *renderer,
+                                  const SDL_Rect *rects, int count);
+int SDL_CosmoBatchUpdateTexture(SDL_CosmoBatch *batch, SDL_Texture *texture,
+                                const SDL_Rect *rect, const void *pixels, int pitch);
+
 #ifdef __cplusplus
 }
 #endif
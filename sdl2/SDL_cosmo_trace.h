@@ -0,0 +1,105 @@
+#ifndef SDL_cosmo_trace_h_
+#define SDL_cosmo_trace_h_
+
+#include "SDL_stdinc.h"
+
+/* The trace written by the shim when built with SDL_COSMO_TRACE and run
+ * with SDL_COSMO_TRACE_FILE set, and read back by sdl_replay.
+ *
+ * A trace starts with a struct trace_header, followed by the names of the
+ * procedures it may refer to, each terminated by a NUL, padded to a
+ * multiple of 8 bytes. Procedure ids in records index this list. Then come
+ * the records, one per call, each a struct trace_record followed by its
+ * arguments. An argument is a struct trace_arg followed by size bytes,
+ * padded to a multiple of 4. Records are padded to a multiple of 8. */
+
+#define SDL_COSMO_TRACE_MAGIC "SDLTRACE"
+#define SDL_COSMO_TRACE_VERSION 1
+
+/* longest string argument kept in a trace, longer ones are truncated */
+#define SDL_COSMO_TRACE_STRING_MAX 200
+
+enum {
+    SDL_COSMO_TRACE_VALUE,   /* the argument's bytes, integers and floats */
+    SDL_COSMO_TRACE_POINTER, /* an opaque pointer */
+    SDL_COSMO_TRACE_STRING,  /* a digest of the string, then the string */
+    SDL_COSMO_TRACE_DATA,    /* the structure pointed to */
+    SDL_COSMO_TRACE_NULL,    /* a null pointer */
+};
+
+struct trace_header {
+    char magic[8];
+    Uint32 version;
+    Uint32 procs;
+};
+
+struct trace_record {
+    Uint32 size;     /* including the arguments and padding */
+    Uint16 proc;
+    Uint16 thread;   /* numbered in order of their first call */
+    Uint64 start;    /* in ns since the trace was started */
+    Uint32 duration; /* in ns */
+    Uint8 args;
+    Uint8 ret_kind;
+    Uint16 unused;
+    Uint64 ret;      /* the first 8 bytes of the return value */
+};
+
+struct trace_arg {
+    Uint8 kind;
+    Uint8 unused;
+    Uint16 size;
+};
+
+#define SDL_COSMO_TRACE_ALIGN(n, a) (((n) + (a) - 1) & ~(size_t)((a) - 1))
+
+/* expands m(ctx, i, arg) for each argument of a procedure, given a
+ * parenthesized argument list like the ones in SDL_dynapi_procs.inc */
+#define SDL_COSMO_TRACE_EACH(m, ctx, args) \
+    SDL_COSMO_TRACE_EACH_(m, ctx, SDL_COSMO_TRACE_COUNT args, SDL_COSMO_TRACE_UNPAREN args)
+#define SDL_COSMO_TRACE_EACH_(m, ctx, n, ...) SDL_COSMO_TRACE_EACH__(m, ctx, n, __VA_ARGS__)
+#define SDL_COSMO_TRACE_EACH__(m, ctx, n, ...) SDL_COSMO_TRACE_EACH_##n(m, ctx, __VA_ARGS__)
+#define SDL_COSMO_TRACE_UNPAREN(...) __VA_ARGS__
+#define SDL_COSMO_TRACE_COUNT(...) \
+    SDL_COSMO_TRACE_COUNT_(_, ##__VA_ARGS__, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+#define SDL_COSMO_TRACE_COUNT_(_0, _1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, n, ...) n
+
+#define SDL_COSMO_TRACE_EACH_0(m, c, ...)
+#define SDL_COSMO_TRACE_EACH_1(m, c, a) m(c, 0, a)
+#define SDL_COSMO_TRACE_EACH_2(m, c, a, b) SDL_COSMO_TRACE_EACH_1(m, c, a) m(c, 1, b)
+#define SDL_COSMO_TRACE_EACH_3(m, c, a, b, d) SDL_COSMO_TRACE_EACH_2(m, c, a, b) m(c, 2, d)
+#define SDL_COSMO_TRACE_EACH_4(m, c, a, b, d, e) SDL_COSMO_TRACE_EACH_3(m, c, a, b, d) m(c, 3, e)
+#define SDL_COSMO_TRACE_EACH_5(m, c, a, b, d, e, f) \
+    SDL_COSMO_TRACE_EACH_4(m, c, a, b, d, e) m(c, 4, f)
+#define SDL_COSMO_TRACE_EACH_6(m, c, a, b, d, e, f, g) \
+    SDL_COSMO_TRACE_EACH_5(m, c, a, b, d, e, f) m(c, 5, g)
+#define SDL_COSMO_TRACE_EACH_7(m, c, a, b, d, e, f, g, h) \
+    SDL_COSMO_TRACE_EACH_6(m, c, a, b, d, e, f, g) m(c, 6, h)
+#define SDL_COSMO_TRACE_EACH_8(m, c, a, b, d, e, f, g, h, i) \
+    SDL_COSMO_TRACE_EACH_7(m, c, a, b, d, e, f, g, h) m(c, 7, i)
+#define SDL_COSMO_TRACE_EACH_9(m, c, a, b, d, e, f, g, h, i, j) \
+    SDL_COSMO_TRACE_EACH_8(m, c, a, b, d, e, f, g, h, i) m(c, 8, j)
+#define SDL_COSMO_TRACE_EACH_10(m, c, a, b, d, e, f, g, h, i, j, k) \
+    SDL_COSMO_TRACE_EACH_9(m, c, a, b, d, e, f, g, h, i, j) m(c, 9, k)
+#define SDL_COSMO_TRACE_EACH_11(m, c, a, b, d, e, f, g, h, i, j, k, l) \
+    SDL_COSMO_TRACE_EACH_10(m, c, a, b, d, e, f, g, h, i, j, k) m(c, 10, l)
+#define SDL_COSMO_TRACE_EACH_12(m, c, a, b, d, e, f, g, h, i, j, k, l, o) \
+    SDL_COSMO_TRACE_EACH_11(m, c, a, b, d, e, f, g, h, i, j, k, l) m(c, 11, o)
+
+/* picks the i-th element of a parenthesized list, used to pair the
+ * declarations of a procedure's parameters with their names */
+#define SDL_COSMO_TRACE_NTH(i, list) SDL_COSMO_TRACE_NTH_##i list
+#define SDL_COSMO_TRACE_NTH_0(a, ...) a
+#define SDL_COSMO_TRACE_NTH_1(_0, a, ...) a
+#define SDL_COSMO_TRACE_NTH_2(_0, _1, a, ...) a
+#define SDL_COSMO_TRACE_NTH_3(_0, _1, _2, a, ...) a
+#define SDL_COSMO_TRACE_NTH_4(_0, _1, _2, _3, a, ...) a
+#define SDL_COSMO_TRACE_NTH_5(_0, _1, _2, _3, _4, a, ...) a
+#define SDL_COSMO_TRACE_NTH_6(_0, _1, _2, _3, _4, _5, a, ...) a
+#define SDL_COSMO_TRACE_NTH_7(_0, _1, _2, _3, _4, _5, _6, a, ...) a
+#define SDL_COSMO_TRACE_NTH_8(_0, _1, _2, _3, _4, _5, _6, _7, a, ...) a
+#define SDL_COSMO_TRACE_NTH_9(_0, _1, _2, _3, _4, _5, _6, _7, _8, a, ...) a
+#define SDL_COSMO_TRACE_NTH_10(_0, _1, _2, _3, _4, _5, _6, _7, _8, _9, a, ...) a
+#define SDL_COSMO_TRACE_NTH_11(_0, _1, _2, _3, _4, _5, _6, _7, _8, _9, _10, a, ...) a
+
+#endif /* SDL_cosmo_trace_h_ */
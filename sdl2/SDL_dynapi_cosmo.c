@@ -29,43 +29,60 @@
 
 #define _COSMO_SOURCE
 #include "libc/runtime/runtime.h"
+#include "libc/calls/calls.h"
 #include "libc/thread/thread.h"
 #include "libc/dlopen/dlfcn.h"
 #include "libc/dce.h"
 #include "libc/assert.h"
 #include "libc/isystem/fcntl.h"
+#include "libc/isystem/stdlib.h"
+#include "libc/isystem/time.h"
+#include "libc/isystem/sys/stat.h"
 #include "libc/str/str.h"
 #include "libc/temp.h"
 #include "libc/errno.h"
 #include "libc/log/log.h"
+#include "libc/nexgen32e/rdtsc.h"
+#include "libc/sysv/consts/map.h"
+#include "libc/sysv/consts/prot.h"
 
 #include "SDL.h"
 #include "SDL_syswm.h"
 #include "SDL_vulkan.h"
+#include "SDL_cosmo.h"
+#include "SDL_cosmo_trace.h"
 
 static char cosmo_error[1024];
 
+/* for the timings in the diagnostics */
+static long long MonotonicNanos(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
 /* all the procedures listed here necessarily rely on callbacks. mask them while we dont have a
- * prettier way to deal with them */
+ * prettier way to deal with them. the ones that do are wrapped at the end of this file */
 #define SDL_SetAssertionHandler SDL_SetAssertionHandler_REAL
-#define SDL_SetEventFilter SDL_SetEventFilter_REAL
-#define SDL_AddEventWatch SDL_AddEventWatch_REAL
-#define SDL_FilterEvents SDL_FilterEvents_REAL
-#define SDL_AddHintCallback SDL_AddHintCallback_REAL
-#define SDL_LogSetOutputFunction SDL_LogSetOutputFunction_REAL
 #define SDL_SetMemoryFunctions SDL_SetMemoryFunctions_REAL
-#define SDL_CreateThread SDL_CreateThread_REAL
-#define SDL_CreateThreadWithStackSize SDL_CreateThreadWithStackSize_REAL
-#define SDL_AddTimer SDL_AddTimer_REAL
 #define SDL_SetWindowHitTest SDL_SetWindowHitTest_REAL
 
 /* these only rely on callbacks in certain cases */
-#define SDL_OpenAudioDevice SDL_OpenAudioDevice_REAL
 #define SDL_OpenAudio SDL_OpenAudio_REAL
 
 /* set to 1 to skip the search for system libraries */
 #define FORCE_BUNDLED_LIBRARY 0
 
+/* hashes of the bundled libraries, passed in by the Makefile. they name the
+ * directory the libraries are cached in once extracted */
+#ifndef SDL2_DLL_HASH
+#define SDL2_DLL_HASH "unknown"
+#endif
+#ifndef SDL2_DYLIB_HASH
+#define SDL2_DYLIB_HASH "unknown"
+#endif
+
 /* Can't use the macro for varargs nonsense. This is atrocious. */
 #define SDL_DYNAPI_VARARGS_LOGFN(_static, name, initcall, logname, prio)                                     \
     _static void SDLCALL SDL_Log##logname##name(int category, SDL_PRINTF_FORMAT_STRING const char *fmt, ...) \
@@ -73,8 +90,7 @@ static char cosmo_error[1024];
         va_list ap;                                                                                          \
         initcall;                                                                                            \
         va_start(ap, fmt);                                                                                   \
-        if (IsWindows()) jump_table.SDL_LogMessageV.ms_abi(category, SDL_LOG_PRIORITY_##prio,fmt, ap);       \
-        else jump_table.SDL_LogMessageV.sysv_abi(category, SDL_LOG_PRIORITY_##prio, fmt, ap);                \
+        jump_table.SDL_LogMessageV.sysv_abi(category, SDL_LOG_PRIORITY_##prio, fmt, ap);                     \
         va_end(ap);                                                                                          \
     }
 
@@ -86,27 +102,22 @@ static char cosmo_error[1024];
         va_list ap;                                                                                                                       \
         initcall;                                                                                                                         \
         va_start(ap, fmt);                                                                                                                \
-        if (IsWindows()) result = jump_table.SDL_vsnprintf.ms_abi(buf, sizeof(buf), fmt, ap);                                             \
-        else result = jump_table.SDL_vsnprintf.sysv_abi(buf, sizeof(buf), fmt, ap);                                                       \
+        result = jump_table.SDL_vsnprintf.sysv_abi(buf, sizeof(buf), fmt, ap);                                                            \
         va_end(ap);                                                                                                                       \
         if (result >= 0 && (size_t)result >= sizeof(buf)) {                                                                               \
             size_t len = (size_t)result + 1;                                                                                              \
-            if (IsWindows()) str = (char *)jump_table.SDL_malloc.ms_abi(len);                                                             \
-            else str = (char *)jump_table.SDL_malloc.sysv_abi(len);                                                                       \
+            str = (char *)jump_table.SDL_malloc.sysv_abi(len);                                                                            \
             if (str) {                                                                                                                    \
                 va_start(ap, fmt);                                                                                                        \
-                if (IsWindows()) result = jump_table.SDL_vsnprintf.ms_abi(str, len, fmt, ap);                                             \
-	        else result = jump_table.SDL_vsnprintf.sysv_abi(str, len, fmt, ap);                                                       \
+                result = jump_table.SDL_vsnprintf.sysv_abi(str, len, fmt, ap);                                                            \
                 va_end(ap);                                                                                                               \
             }                                                                                                                             \
         }                                                                                                                                 \
         if (result >= 0) {                                                                                                                \
-            if (IsWindows()) result = jump_table.SDL_SetError.ms_abi("%s", str);                                                          \
-            else result = jump_table.SDL_SetError.sysv_abi("%s", str);                                                                    \
+            result = jump_table.SDL_SetError.sysv_abi("%s", str);                                                                         \
         }                                                                                                                                 \
         if (str != buf) {                                                                                                                 \
-            if (IsWindows()) jump_table.SDL_free.ms_abi(str);                                                                             \
-            else jump_table.SDL_free.sysv_abi(str);                                                                                       \
+            jump_table.SDL_free.sysv_abi(str);                                                                                            \
         }                                                                                                                                 \
         return result;                                                                                                                    \
     }                                                                                                                                     \
@@ -116,8 +127,7 @@ static char cosmo_error[1024];
         va_list ap;                                                                                                                       \
         initcall;                                                                                                                         \
         va_start(ap, fmt);                                                                                                                \
-        if (IsWindows()) retval = jump_table.SDL_vsscanf.ms_abi(buf, fmt, ap);                                                            \
-        else retval = jump_table.SDL_vsscanf.sysv_abi(buf, fmt, ap);                                                                      \
+        retval = jump_table.SDL_vsscanf.sysv_abi(buf, fmt, ap);                                                                           \
         va_end(ap);                                                                                                                       \
         return retval;                                                                                                                    \
     }                                                                                                                                     \
@@ -127,8 +137,7 @@ static char cosmo_error[1024];
         va_list ap;                                                                                                                       \
         initcall;                                                                                                                         \
         va_start(ap, fmt);                                                                                                                \
-        if (IsWindows()) retval = jump_table.SDL_vsnprintf.ms_abi(buf, maxlen, fmt, ap);                                                  \
-        else retval = jump_table.SDL_vsnprintf.sysv_abi(buf, maxlen, fmt, ap);                                                            \
+        retval = jump_table.SDL_vsnprintf.sysv_abi(buf, maxlen, fmt, ap);                                                                 \
         va_end(ap);                                                                                                                       \
         return retval;                                                                                                                    \
     }                                                                                                                                     \
@@ -137,8 +146,7 @@ static char cosmo_error[1024];
         va_list ap;                                                                                                                       \
         initcall;                                                                                                                         \
         va_start(ap, fmt);                                                                                                                \
-        if (IsWindows()) jump_table.SDL_LogMessageV.ms_abi(SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_INFO, fmt, ap);                 \
-        else jump_table.SDL_LogMessageV.sysv_abi(SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_INFO, fmt, ap);                           \
+        jump_table.SDL_LogMessageV.sysv_abi(SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_INFO, fmt, ap);                                \
         va_end(ap);                                                                                                                       \
     }                                                                                                                                     \
     _static void SDLCALL SDL_LogMessage##name(int category, SDL_LogPriority priority, SDL_PRINTF_FORMAT_STRING const char *fmt, ...)      \
@@ -146,8 +154,7 @@ static char cosmo_error[1024];
         va_list ap;                                                                                                                       \
         initcall;                                                                                                                         \
         va_start(ap, fmt);                                                                                                                \
-        if (IsWindows()) jump_table.SDL_LogMessageV.ms_abi(category, priority, fmt, ap);                                                  \
-        else jump_table.SDL_LogMessageV.sysv_abi(category, priority, fmt, ap);                                                            \
+        jump_table.SDL_LogMessageV.sysv_abi(category, priority, fmt, ap);                                                                 \
         va_end(ap);                                                                                                                       \
     }                                                                                                                                     \
     SDL_DYNAPI_VARARGS_LOGFN(_static, name, initcall, Verbose, VERBOSE)                                                                   \
@@ -180,15 +187,512 @@ typedef struct
 #include "SDL_dynapi_procs.inc"
 #undef SDL_DYNAPI_PROC
 
-/* The actual jump table. */
+/* The actual jump table. Every slot is always callable with the sysv calling
+ * convention, so the public wrappers below never have to look at the host. */
 static SDL_DYNAPI_jump_table jump_table = { 0 };
 
-/* Public API functions to jump into the jump table. */
+/* The procedures as exported by the native library. On Windows these are
+ * ms_abi, and the jump table points at the thunks defined below instead. */
+static SDL_DYNAPI_jump_table native_table = { 0 };
+
+/* sysv to ms_abi thunks, installed into the jump table on Windows. */
 #define SDL_DYNAPI_PROC(rc, fn, params, args, ret)      \
-    rc SDLCALL fn params                                \
+    static rc SDLCALL fn##_MS params                    \
     {                                                   \
-	if (IsWindows()) ret jump_table.fn.ms_abi args; \
-	else ret jump_table.fn.sysv_abi args;           \
+	ret native_table.fn.ms_abi args;                \
+    }
+#define SDL_DYNAPI_PROC_NO_VARARGS 1
+#include "SDL_dynapi_procs.inc"
+#undef SDL_DYNAPI_PROC
+#undef SDL_DYNAPI_PROC_NO_VARARGS
+
+/* varargs can't be forwarded, but the only variadic procedure reached through
+ * the jump table is SDL_SetError, and it is always called with "%s" */
+static int SDLCALL SDL_SetError_MS(SDL_PRINTF_FORMAT_STRING const char *fmt, ...)
+{
+    const char *str;
+    va_list ap;
+    va_start(ap, fmt);
+    str = va_arg(ap, const char *);
+    va_end(ap);
+    return native_table.SDL_SetError.ms_abi("%s", str);
+}
+
+/* The native library, kept around for binding procedures on first use. */
+static void *native_lib;
+
+/* Bookkeeping for the startup diagnostics. */
+static int bind_count;
+static long long bind_nanos;
+
+/* Resolves a procedure from the native library and installs it into its jump
+ * table slot. This may run concurrently from any thread calling into SDL for
+ * the first time; racing threads all store the same pointer. */
+static void BindProc(const char *name, void **native, void *ms_thunk, void **slot)
+{
+    long long start = MonotonicNanos();
+    void *ptr;
+    ptr = cosmo_dlsym(native_lib, name);
+    if (ptr == NULL) {
+        FWARNF(stderr, "failed to load symbol %s from native SDL: %s",
+	    name, cosmo_dlerror());
+    }
+    if (IsWindows()) {
+        __atomic_store_n(native, ptr, __ATOMIC_RELEASE);
+        ptr = ms_thunk;
+    } else {
+        ptr = cosmo_dltramp(ptr);
+    }
+    __atomic_store_n(slot, ptr, __ATOMIC_RELEASE);
+    __atomic_fetch_add(&bind_count, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&bind_nanos, MonotonicNanos() - start, __ATOMIC_RELAXED);
+}
+
+/* Resolver stubs, installed into the jump table when binding lazily. Each
+ * one binds its own slot and then calls through it. */
+#define SDL_DYNAPI_PROC(rc, fn, params, args, ret)                         \
+    static rc SDLCALL fn##_LAZY params                                     \
+    {                                                                      \
+        BindProc(#fn, &native_table.fn.ptr, (void *)fn##_MS,               \
+            &jump_table.fn.ptr);                                           \
+	ret jump_table.fn.sysv_abi args;                                   \
+    }
+#define SDL_DYNAPI_PROC_NO_VARARGS 1
+#include "SDL_dynapi_procs.inc"
+#undef SDL_DYNAPI_PROC
+#undef SDL_DYNAPI_PROC_NO_VARARGS
+
+static void LogLazyBinding(void)
+{
+    FLOGF(stderr, "bound %d procedures from native SDL on first use in %lld us",
+        bind_count, bind_nanos / 1000);
+}
+
+#if defined(SDL_COSMO_STATS) || defined(SDL_COSMO_TRACE)
+/* Procedure ids, for instrumentation. */
+#define SDL_DYNAPI_PROC(rc, fn, params, args, ret) SDL_COSMO_ID_##fn,
+#define SDL_DYNAPI_PROC_NO_VARARGS 1
+enum {
+#include "SDL_dynapi_procs.inc"
+    SDL_COSMO_PROC_COUNT
+};
+#undef SDL_DYNAPI_PROC
+#undef SDL_DYNAPI_PROC_NO_VARARGS
+
+static const char *const proc_names[] = {
+#define SDL_DYNAPI_PROC(rc, fn, params, args, ret) #fn,
+#define SDL_DYNAPI_PROC_NO_VARARGS 1
+#include "SDL_dynapi_procs.inc"
+#undef SDL_DYNAPI_PROC
+#undef SDL_DYNAPI_PROC_NO_VARARGS
+};
+#endif
+
+#ifdef SDL_COSMO_STATS
+/* Call statistics, kept when built with SDL_COSMO_STATS. Every public
+ * procedure counts its calls and the cycles spent in them, bucketed into a
+ * power of two histogram. The table lives in static memory, or in a shared
+ * mapping of the file named by SDL_COSMO_STATS_FILE so other processes can
+ * watch it while the program runs. */
+
+#define STATS_BUCKETS 32
+
+struct proc_stats {
+    char name[48];
+    unsigned long long calls;
+    unsigned long long cycles;
+    unsigned long long hist[STATS_BUCKETS]; /* calls taking < 2**i cycles */
+};
+
+struct stats_table {
+    char magic[8]; /* "SDLSTAT1" */
+    int procs;
+    int buckets;
+    struct proc_stats proc[SDL_COSMO_PROC_COUNT];
+};
+
+static struct stats_table stats_static;
+static struct stats_table *stats = &stats_static;
+
+struct stats_scope {
+    int id;
+    unsigned long long start;
+};
+
+static void StatsEnd(struct stats_scope *scope)
+{
+    struct proc_stats *ps = &stats->proc[scope->id];
+    unsigned long long cycles = rdtsc() - scope->start;
+    int bucket = 64 - __builtin_clzll(cycles | 1);
+    if (bucket >= STATS_BUCKETS) bucket = STATS_BUCKETS - 1;
+    __atomic_fetch_add(&ps->calls, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&ps->cycles, cycles, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&ps->hist[bucket], 1, __ATOMIC_RELAXED);
+}
+
+static void StatsInit(void)
+{
+    struct stats_table *table;
+    const char *path;
+    int fd, i;
+
+    if ((path = getenv("SDL_COSMO_STATS_FILE")) && *path) {
+        table = MAP_FAILED;
+        if ((fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644)) != -1) {
+            if (!ftruncate(fd, sizeof(*table)))
+                table = mmap(NULL, sizeof(*table), PROT_READ | PROT_WRITE,
+                    MAP_SHARED, fd, 0);
+            close(fd);
+        }
+        if (table != MAP_FAILED)
+            stats = table;
+        else
+            FWARNF(stderr, "could not map %s, keeping call statistics in memory: %m", path);
+    }
+
+    memcpy(stats->magic, "SDLSTAT1", 8);
+    stats->procs = SDL_COSMO_PROC_COUNT;
+    stats->buckets = STATS_BUCKETS;
+    for (i = 0; i < SDL_COSMO_PROC_COUNT; i++)
+        strlcpy(stats->proc[i].name, proc_names[i], sizeof(stats->proc[i].name));
+    atexit(SDL_CosmoDumpStats);
+}
+
+static int CompareStats(const void *a, const void *b)
+{
+    const struct proc_stats *x = *(const struct proc_stats *const *)a;
+    const struct proc_stats *y = *(const struct proc_stats *const *)b;
+    return (x->cycles < y->cycles) - (x->cycles > y->cycles);
+}
+
+/* the cycle count under which the given fraction of the calls completed */
+static unsigned long long StatsPercentile(const struct proc_stats *ps, double p)
+{
+    unsigned long long seen = 0;
+    int i;
+    for (i = 0; i < STATS_BUCKETS - 1; i++)
+        if ((seen += ps->hist[i]) >= ps->calls * p)
+            break;
+    return 1ull << i;
+}
+
+void SDL_CosmoDumpStats(void)
+{
+    static struct proc_stats *sorted[SDL_COSMO_PROC_COUNT];
+    unsigned long long total = 0;
+    int i, n = 0;
+
+    for (i = 0; i < SDL_COSMO_PROC_COUNT; i++)
+        if (stats->proc[i].calls) {
+            sorted[n++] = &stats->proc[i];
+            total += stats->proc[i].cycles;
+        }
+    qsort(sorted, n, sizeof(*sorted), CompareStats);
+
+    fprintf(stderr, "%-40s %12s %16s %6s %10s %10s %10s\n", "procedure", "calls",
+        "cycles", "%", "avg", "p50<", "p99<");
+    for (i = 0; i < n; i++)
+        fprintf(stderr, "%-40s %12llu %16llu %6.2f %10llu %10llu %10llu\n",
+            sorted[i]->name, sorted[i]->calls, sorted[i]->cycles,
+            sorted[i]->cycles * 100. / total, sorted[i]->cycles / sorted[i]->calls,
+            StatsPercentile(sorted[i], .5), StatsPercentile(sorted[i], .99));
+}
+
+/* times the rest of a public procedure. the cleanup runs after the return
+ * value has been computed */
+#define SDL_COSMO_STATS_SCOPE(id)                       \
+        struct stats_scope scope                        \
+            __attribute__((__cleanup__(StatsEnd))) =    \
+            { id, rdtsc() };
+#else
+void SDL_CosmoDumpStats(void)
+{
+    /* nothing is recorded without SDL_COSMO_STATS */
+}
+
+#define SDL_COSMO_STATS_SCOPE(id)
+#endif
+
+#ifdef SDL_COSMO_TRACE
+/* Call tracing, when built with SDL_COSMO_TRACE and SDL_COSMO_TRACE_FILE
+ * names a file. Every call to a public procedure is encoded on the stack of
+ * its caller, then copied into a ring buffer that a background thread
+ * drains into the file. See SDL_cosmo_trace.h for the format. Records are
+ * dropped rather than blocking the caller when the ring fills up. */
+#define TRACE_RING_SIZE (8 << 20)
+#define TRACE_FLUSH_NANOS 10000000
+#define TRACE_RECORD_MAX 2048
+#define TRACE_PAD 0xffff /* proc of the filler records at the end of the ring */
+
+static int trace_fd = -1;
+static unsigned char *trace_ring;
+static unsigned long long trace_head, trace_tail; /* reserved, drained */
+static unsigned long long trace_dropped;
+static long long trace_epoch;
+static int trace_threads, trace_stop;
+static pthread_t trace_flusher;
+static _Thread_local int trace_thread;
+
+struct trace_buf {
+    struct trace_record rec;
+    unsigned char args[TRACE_RECORD_MAX - sizeof(struct trace_record)];
+    size_t used;
+};
+
+/* the structures worth copying into the trace when passed by pointer. other
+ * pointers are recorded as they are */
+#define TRACE_DATA_SIZE(x)                                              \
+    _Generic((x),                                                       \
+        const SDL_Rect *: sizeof(SDL_Rect),                             \
+        const SDL_Point *: sizeof(SDL_Point),                           \
+        const SDL_Color *: sizeof(SDL_Color),                           \
+        const SDL_Palette *: sizeof(SDL_Palette),                       \
+        const SDL_DisplayMode *: sizeof(SDL_DisplayMode),               \
+        const SDL_MessageBoxData *: sizeof(SDL_MessageBoxData),         \
+        default: 0)
+
+#define TRACE_KIND(x)                                                   \
+    _Generic((x),                                                       \
+        const char *: SDL_COSMO_TRACE_STRING,                           \
+        default: TRACE_DATA_SIZE(x) ? SDL_COSMO_TRACE_DATA :            \
+            __builtin_classify_type(x) == 5 ? SDL_COSMO_TRACE_POINTER : \
+            SDL_COSMO_TRACE_VALUE)
+
+static unsigned long long TraceDigest(const char *s, size_t n)
+{
+    unsigned long long h = 0xcbf29ce484222325ull; /* FNV-1a */
+    while (n--) h = (h ^ (unsigned char)*s++) * 0x100000001b3ull;
+    return h;
+}
+
+static void TraceBegin(struct trace_buf *tb, int proc)
+{
+    if (!trace_thread)
+        trace_thread = __atomic_add_fetch(&trace_threads, 1, __ATOMIC_RELAXED);
+    tb->rec.proc = proc;
+    tb->rec.thread = trace_thread;
+    tb->rec.args = 0;
+    tb->used = 0;
+    tb->rec.start = MonotonicNanos();
+}
+
+static void *TraceArgSpace(struct trace_buf *tb, int kind, size_t size)
+{
+    struct trace_arg *arg = (struct trace_arg *)(tb->args + tb->used);
+    arg->kind = kind;
+    arg->unused = 0;
+    arg->size = size;
+    tb->used += SDL_COSMO_TRACE_ALIGN(sizeof(*arg) + size, 4);
+    tb->rec.args++;
+    return arg + 1;
+}
+
+static void TraceArg(struct trace_buf *tb, const void *p, size_t size, int kind, size_t data)
+{
+    const void *ptr;
+    unsigned long long digest;
+    size_t n;
+    char *dst;
+
+    if (kind != SDL_COSMO_TRACE_VALUE) {
+        memcpy(&ptr, p, sizeof(ptr));
+        if (!ptr) kind = SDL_COSMO_TRACE_NULL;
+    }
+    switch (kind) {
+    case SDL_COSMO_TRACE_STRING:
+        n = strlen(ptr);
+        digest = TraceDigest(ptr, n);
+        if (n > SDL_COSMO_TRACE_STRING_MAX) n = SDL_COSMO_TRACE_STRING_MAX;
+        dst = TraceArgSpace(tb, kind, sizeof(digest) + n + 1);
+        memcpy(dst, &digest, sizeof(digest));
+        memcpy(dst + sizeof(digest), ptr, n);
+        dst[sizeof(digest) + n] = 0;
+        break;
+    case SDL_COSMO_TRACE_DATA:
+        memcpy(TraceArgSpace(tb, kind, data), ptr, data);
+        break;
+    case SDL_COSMO_TRACE_NULL:
+        TraceArgSpace(tb, kind, 0);
+        break;
+    default:
+        memcpy(TraceArgSpace(tb, kind, size), p, size);
+        break;
+    }
+}
+
+static void *TraceReserve(size_t size)
+{
+    unsigned long long head, tail, pos, pad;
+    struct trace_record *filler;
+
+    head = __atomic_load_n(&trace_head, __ATOMIC_RELAXED);
+    do {
+        tail = __atomic_load_n(&trace_tail, __ATOMIC_ACQUIRE);
+        pos = head & (TRACE_RING_SIZE - 1);
+        pad = pos + size > TRACE_RING_SIZE ? TRACE_RING_SIZE - pos : 0;
+        if (head + pad + size - tail > TRACE_RING_SIZE) {
+            __atomic_fetch_add(&trace_dropped, 1, __ATOMIC_RELAXED);
+            return NULL;
+        }
+    } while (!__atomic_compare_exchange_n(&trace_head, &head, head + pad + size,
+                 1, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+    if (!pad) return trace_ring + pos;
+    filler = (struct trace_record *)(trace_ring + pos);
+    filler->proc = TRACE_PAD;
+    __atomic_store_n(&filler->size, pad, __ATOMIC_RELEASE);
+    return trace_ring;
+}
+
+static void TraceEnd(struct trace_buf *tb, const void *ret, size_t size, int kind)
+{
+    struct trace_record *rec;
+    size_t total;
+
+    tb->rec.duration = MonotonicNanos() - tb->rec.start;
+    tb->rec.start -= trace_epoch;
+    tb->rec.ret_kind = kind;
+    tb->rec.unused = 0;
+    tb->rec.ret = 0;
+    if (size) memcpy(&tb->rec.ret, ret, size < 8 ? size : 8);
+    total = SDL_COSMO_TRACE_ALIGN(sizeof(tb->rec) + tb->used, 8);
+    if (!(rec = TraceReserve(total))) return;
+    memcpy((unsigned char *)rec + sizeof(rec->size),
+        (unsigned char *)&tb->rec + sizeof(rec->size),
+        sizeof(tb->rec) - sizeof(rec->size) + tb->used);
+    __atomic_store_n(&rec->size, total, __ATOMIC_RELEASE);
+}
+
+/* writes out the records committed so far, in order, and hands the space
+ * back. a reserved record that isn't committed yet stops the flush */
+static void TraceFlush(void)
+{
+    unsigned long long tail, start;
+    struct trace_record *rec;
+    Uint32 size;
+    size_t pos, run = 0;
+
+    tail = start = __atomic_load_n(&trace_tail, __ATOMIC_RELAXED);
+    for (;;) {
+        pos = tail & (TRACE_RING_SIZE - 1);
+        rec = (struct trace_record *)(trace_ring + pos);
+        if (tail == __atomic_load_n(&trace_head, __ATOMIC_ACQUIRE) ||
+            !(size = __atomic_load_n(&rec->size, __ATOMIC_ACQUIRE)))
+            break;
+        if (rec->proc == TRACE_PAD) {
+            if (run) write(trace_fd, trace_ring + (start & (TRACE_RING_SIZE - 1)), run);
+            memset(trace_ring + (start & (TRACE_RING_SIZE - 1)), 0, run + size);
+            run = 0;
+            start = tail + size;
+        } else {
+            run += size;
+        }
+        tail += size;
+        /* a record can end right at the end of the ring, with no pad
+         * after it: the run can't carry on past it */
+        if (run && !(tail & (TRACE_RING_SIZE - 1))) {
+            write(trace_fd, trace_ring + (start & (TRACE_RING_SIZE - 1)), run);
+            memset(trace_ring + (start & (TRACE_RING_SIZE - 1)), 0, run);
+            run = 0;
+            start = tail;
+        }
+    }
+    if (run) {
+        write(trace_fd, trace_ring + (start & (TRACE_RING_SIZE - 1)), run);
+        memset(trace_ring + (start & (TRACE_RING_SIZE - 1)), 0, run);
+    }
+    __atomic_store_n(&trace_tail, tail, __ATOMIC_RELEASE);
+}
+
+static void *TraceFlusher(void *arg)
+{
+    struct timespec ts = {0, TRACE_FLUSH_NANOS};
+    while (!__atomic_load_n(&trace_stop, __ATOMIC_ACQUIRE)) {
+        nanosleep(&ts, NULL);
+        TraceFlush();
+    }
+    return NULL;
+}
+
+static void TraceClose(void)
+{
+    __atomic_store_n(&trace_stop, 1, __ATOMIC_RELEASE);
+    pthread_join(trace_flusher, NULL);
+    TraceFlush();
+    close(trace_fd);
+    FLOGF(stderr, "sdl call trace written, %llu calls dropped", trace_dropped);
+}
+
+static void TraceInit(void)
+{
+    struct trace_header hdr = {SDL_COSMO_TRACE_MAGIC, SDL_COSMO_TRACE_VERSION,
+                               SDL_COSMO_PROC_COUNT};
+    static const char zeros[8];
+    size_t size = 0;
+    const char *path;
+    int fd, i;
+
+    if (!(path = getenv("SDL_COSMO_TRACE_FILE")) || !*path) return;
+    if ((fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644)) == -1) {
+        FWARNF(stderr, "could not open %s, not tracing sdl calls: %m", path);
+        return;
+    }
+    if (!(trace_ring = calloc(1, TRACE_RING_SIZE))) {
+        close(fd);
+        return;
+    }
+    write(fd, &hdr, sizeof(hdr));
+    for (i = 0; i < SDL_COSMO_PROC_COUNT; i++) {
+        write(fd, proc_names[i], strlen(proc_names[i]) + 1);
+        size += strlen(proc_names[i]) + 1;
+    }
+    write(fd, zeros, SDL_COSMO_TRACE_ALIGN(size, 8) - size);
+    trace_fd = fd;
+    trace_epoch = MonotonicNanos();
+    if (pthread_create(&trace_flusher, NULL, TraceFlusher, NULL)) {
+        close(fd);
+        trace_fd = -1;
+        return;
+    }
+    atexit(TraceClose);
+}
+
+/* va_list parameters are pointers in disguise, sizeof of their type says so
+ * without a warning */
+#define SDL_COSMO_TRACE_PUT(tb, i, a) \
+        TraceArg(&tb, &a, sizeof(__typeof__(a)), TRACE_KIND(a), TRACE_DATA_SIZE(a));
+#define SDL_COSMO_TRACE_RET_return(tb, call)                    \
+        return ({                                               \
+            __typeof__(call) r_ = call;                         \
+            TraceEnd(&tb, &r_, sizeof(r_),                      \
+                __builtin_classify_type(r_) == 5 ?              \
+                SDL_COSMO_TRACE_POINTER : SDL_COSMO_TRACE_VALUE); \
+            r_;                                                 \
+        });
+#define SDL_COSMO_TRACE_RET_(tb, call)                          \
+        call;                                                   \
+        TraceEnd(&tb, NULL, 0, SDL_COSMO_TRACE_VALUE);
+
+/* calls the procedure, recording the call if tracing */
+#define SDL_COSMO_TRACE_CALL(id, fn, args, ret)                 \
+        if (trace_fd < 0) {                                     \
+            ret jump_table.fn.sysv_abi args;                    \
+        } else {                                                \
+            struct trace_buf tb;                                \
+            TraceBegin(&tb, id);                                \
+            SDL_COSMO_TRACE_EACH(SDL_COSMO_TRACE_PUT, tb, args) \
+            SDL_COSMO_TRACE_RET_##ret(tb, jump_table.fn.sysv_abi args) \
+        }
+#else
+#define SDL_COSMO_TRACE_CALL(id, fn, args, ret) ret jump_table.fn.sysv_abi args;
+#endif
+
+/* Public API functions to jump into the jump table. The ids are pasted here,
+ * before the masked procedures get their names expanded. */
+#define SDL_DYNAPI_PROC(rc, fn, params, args, ret)              \
+    rc SDLCALL fn params                                        \
+    {                                                           \
+        SDL_COSMO_STATS_SCOPE(SDL_COSMO_ID_##fn)                \
+        SDL_COSMO_TRACE_CALL(SDL_COSMO_ID_##fn, fn, args, ret)  \
     }
 #define SDL_DYNAPI_PROC_NO_VARARGS 1
 #include "SDL_dynapi_procs.inc"
@@ -196,11 +700,44 @@ static SDL_DYNAPI_jump_table jump_table = { 0 };
 #undef SDL_DYNAPI_PROC_NO_VARARGS
 SDL_DYNAPI_VARARGS(, , )
 
+/* copies size bytes from fdin to fdout. the kernel gets to try first, but
+ * that only works on some hosts and only if fdin is a real file, which files
+ * under /zip/ never are. otherwise, stored (uncompressed) zip entries are
+ * plain copies out of the executable, so big buffers are all that helps */
+static int CopyData(int fdin, int fdout, long long size, const char **how)
+{
+    char *buf;
+    ssize_t rc, wrote, n;
+    long long done = 0;
+    while (done < size && (rc = copy_file_range(fdin, NULL, fdout, NULL, size - done, 0)) > 0)
+        done += rc;
+    if (done == size) {
+        *how = "copy_file_range";
+        return 0;
+    }
+    *how = "read/write";
+    if (!(buf = malloc(1 << 20))) return -1;
+    while ((rc = read(fdin, buf, 1 << 20)) > 0) {
+        for (wrote = 0; wrote < rc; wrote += n) {
+            if ((n = write(fdout, buf + wrote, rc - wrote)) <= 0) {
+                free(buf);
+                return -1;
+            }
+        }
+    }
+    free(buf);
+    return rc;
+}
+
 /* adapted from llamafile_extract */
 int ExtractFromZip(const char *zip, const char *to) {
     int fdin, fdout;
     char stage[PATH_MAX];
+    struct stat st;
+    const char *how;
+    long long start, opened, copied, closed, renamed;
     FLOGF(stderr, "extracting %s to %s", zip, to);
+    start = MonotonicNanos();
     strlcpy(stage, to, sizeof(stage));
     if (strlcat(stage, ".XXXXXX", sizeof(stage)) >= sizeof(stage)) {
         errno = ENAMETOOLONG;
@@ -217,13 +754,22 @@ int ExtractFromZip(const char *zip, const char *to) {
         unlink(stage);
         return 0;
     }
-    if (copyfd(fdin, fdout, -1) == -1) {
+    if (fstat(fdin, &st)) {
         perror(zip);
         close(fdin);
         close(fdout);
         unlink(stage);
         return 0;
     }
+    opened = MonotonicNanos();
+    if (CopyData(fdin, fdout, st.st_size, &how) == -1) {
+        perror(zip);
+        close(fdin);
+        close(fdout);
+        unlink(stage);
+        return 0;
+    }
+    copied = MonotonicNanos();
     if (close(fdout)) {
         perror(to);
         close(fdin);
@@ -235,19 +781,126 @@ int ExtractFromZip(const char *zip, const char *to) {
         unlink(stage);
         return 0;
     }
+    closed = MonotonicNanos();
     if (rename(stage, to)) {
         perror(to);
         unlink(stage);
         return 0;
     }
+    renamed = MonotonicNanos();
+    FLOGF(stderr, "extracted %lld bytes with %s in %lld us "
+        "(open %lld us, copy %lld us, close %lld us, rename %lld us)",
+        (long long)st.st_size, how, (renamed - start) / 1000,
+        (opened - start) / 1000, (copied - opened) / 1000,
+        (closed - copied) / 1000, (renamed - closed) / 1000);
+    return 1;
+}
+
+/* the bundled libraries are cached per user, under a directory named after
+ * the hash the Makefile pins them to */
+static int CacheDir(char *buf, size_t size, const char *hash)
+{
+    const char *base;
+    int n;
+    if (IsWindows() && (base = getenv("LOCALAPPDATA")) && *base) {
+        n = snprintf(buf, size, "%s/cosmo-sdl2/%s", base, hash);
+    } else if (IsXnu() && (base = getenv("HOME")) && *base) {
+        n = snprintf(buf, size, "%s/Library/Caches/cosmo-sdl2/%s", base, hash);
+    } else if ((base = getenv("XDG_CACHE_HOME")) && *base) {
+        n = snprintf(buf, size, "%s/cosmo-sdl2/%s", base, hash);
+    } else if ((base = getenv("HOME")) && *base) {
+        n = snprintf(buf, size, "%s/.cache/cosmo-sdl2/%s", base, hash);
+    } else {
+        return 0;
+    }
+    return n > 0 && (size_t)n < size;
+}
+
+static int MakeDirs(char *path)
+{
+    char *p;
+    for (p = path + 1; *p; p++) {
+        if (*p != '/') continue;
+        *p = 0;
+        if (mkdir(path, 0755) && errno != EEXIST) {
+            *p = '/';
+            return 0;
+        }
+        *p = '/';
+    }
+    return !mkdir(path, 0755) || errno == EEXIST;
+}
+
+/* the stamp written next to a cached library records what it was extracted
+ * as. if the library has been touched since, it won't match anymore */
+static void FormatStamp(char *buf, size_t size, const char *hash, const struct stat *st)
+{
+    snprintf(buf, size, "%s %lld %lld\n", hash,
+        (long long)st->st_size, (long long)st->st_mtime);
+}
+
+static int CheckStamp(const char *path, const char *hash, long long size)
+{
+    char stamp[PATH_MAX], expected[128], actual[128];
+    struct stat st;
+    ssize_t n;
+    int fd;
+    if (stat(path, &st) || st.st_size != size) return 0;
+    snprintf(stamp, sizeof stamp, "%s.stamp", path);
+    if ((fd = open(stamp, O_RDONLY | O_CLOEXEC)) == -1) return 0;
+    n = read(fd, actual, sizeof actual - 1);
+    close(fd);
+    if (n <= 0) return 0;
+    actual[n] = 0;
+    FormatStamp(expected, sizeof expected, hash, &st);
+    return !strcmp(actual, expected);
+}
+
+static void WriteStamp(const char *path, const char *hash)
+{
+    char stamp[PATH_MAX], stage[PATH_MAX], buf[128];
+    struct stat st;
+    int fd, ok;
+    if (stat(path, &st)) return;
+    snprintf(stamp, sizeof stamp, "%s.stamp", path);
+    snprintf(stage, sizeof stage, "%s.XXXXXX", stamp);
+    if ((fd = mkostemp(stage, O_CLOEXEC)) == -1) return;
+    FormatStamp(buf, sizeof buf, hash, &st);
+    ok = write(fd, buf, strlen(buf)) == (ssize_t)strlen(buf);
+    if (close(fd) || !ok || rename(stage, stamp)) unlink(stage);
+}
+
+/* extracts a bundled library into the cache, unless a valid copy is already
+ * there. falls back to the current directory if there is no usable cache */
+static int ExtractCached(const char *zip, const char *name, const char *hash,
+    char *path, size_t size)
+{
+    struct stat st;
+    if (stat(zip, &st)) {
+        perror(zip);
+        return 0;
+    }
+    if (!CacheDir(path, size, hash) || !MakeDirs(path) ||
+        strlcat(path, "/", size) >= size || strlcat(path, name, size) >= size) {
+        FLOGF(stderr, "no usable cache directory for %s", name);
+        snprintf(path, size, "./%s", name);
+        return ExtractFromZip(zip, path);
+    }
+    if (CheckStamp(path, hash, st.st_size)) {
+        FLOGF(stderr, "using cached %s", path);
+        return 1;
+    }
+    if (!ExtractFromZip(zip, path)) return 0;
+    WriteStamp(path, hash);
     return 1;
 }
 
 static void *ExtractDLL_x86_64(void)
 {
+  char path[PATH_MAX];
   void *dll;
-    if (ExtractFromZip("/zip/SDL2.dll", "./SDL2.dll")) {
-    	dll = cosmo_dlopen("./SDL2.dll", RTLD_LAZY | RTLD_LOCAL);
+    if (ExtractCached("/zip/SDL2.dll", "SDL2.dll", SDL2_DLL_HASH, path, sizeof path)) {
+    	dll = cosmo_dlopen(path, RTLD_LAZY | RTLD_LOCAL);
 	    if (!dll) snprintf(cosmo_error, sizeof cosmo_error,
           "could not load bundled SDL2.dll after extracting: %s",
 			    cosmo_dlerror());
@@ -261,9 +914,10 @@ static void *ExtractDLL_x86_64(void)
 
 static void *ExtractDylib(void)
 {
+  char path[PATH_MAX];
   void *dll;
-    if (ExtractFromZip("/zip/libSDL2.dylib", "./libSDL2.dylib")) {
-    	dll = cosmo_dlopen("./libSDL2.dylib", RTLD_LAZY | RTLD_LOCAL);
+    if (ExtractCached("/zip/libSDL2.dylib", "libSDL2.dylib", SDL2_DYLIB_HASH, path, sizeof path)) {
+    	dll = cosmo_dlopen(path, RTLD_LAZY | RTLD_LOCAL);
 	    if (!dll) snprintf(cosmo_error, sizeof cosmo_error,
           "could not load bundled libSDL2.dylib after extracting: %s",
 			    cosmo_dlerror());
@@ -275,6 +929,8 @@ static void *ExtractDylib(void)
     }
 }
 
+static void WrapCallbacks(void);
+
 int SDL_CosmoInit(void)
 {
     const char *libname_cascade[] = {
@@ -287,8 +943,16 @@ int SDL_CosmoInit(void)
 	    NULL
     };
     const char **libname;
+    const char *bind_now;
     void *lib = NULL;
 
+#ifdef SDL_COSMO_STATS
+    StatsInit();
+#endif
+#ifdef SDL_COSMO_TRACE
+    TraceInit();
+#endif
+
     for (libname = libname_cascade; *libname; libname+=1) {
         if ((lib = cosmo_dlopen(*libname, RTLD_LAZY | RTLD_LOCAL))) {
 	    FLOGF(stderr, "found native SDL with filename %s", *libname);
@@ -325,15 +989,35 @@ int SDL_CosmoInit(void)
         return 1;
     }
 
+    native_lib = lib;
+
+    /* variadic procedures get neither thunks nor resolver stubs. the only
+     * one reached through the jump table is SDL_SetError, bind it now */
+    BindProc("SDL_SetError", &native_table.SDL_SetError.ptr,
+        (void *)SDL_SetError_MS, &jump_table.SDL_SetError.ptr);
+
+    /* like LD_BIND_NOW, resolve everything up front if asked to */
+    bind_now = getenv("SDL_COSMO_BIND_NOW");
+    if (bind_now && *bind_now) {
 #define SDL_DYNAPI_PROC(rc, fn, params, args, ret)                         \
-    jump_table.fn.ptr = cosmo_dlsym(lib, #fn);                             \
-    if (jump_table.fn.ptr == NULL) {                                       \
-        FWARNF(stderr, "failed to load symbol %s from native SDL: %s",     \
-	    #fn, cosmo_dlerror());                                         \
-    }                                                                      \
-    if (!IsWindows()) jump_table.fn.ptr = cosmo_dltramp(jump_table.fn.ptr);
+        BindProc(#fn, &native_table.fn.ptr, (void *)fn##_MS,               \
+            &jump_table.fn.ptr);
+#define SDL_DYNAPI_PROC_NO_VARARGS 1
+#include "SDL_dynapi_procs.inc"
+#undef SDL_DYNAPI_PROC
+#undef SDL_DYNAPI_PROC_NO_VARARGS
+        FLOGF(stderr, "bound %d procedures from native SDL in %lld us",
+            bind_count, bind_nanos / 1000);
+    } else {
+#define SDL_DYNAPI_PROC(rc, fn, params, args, ret) jump_table.fn.sysv_abi = fn##_LAZY;
+#define SDL_DYNAPI_PROC_NO_VARARGS 1
 #include "SDL_dynapi_procs.inc"
 #undef SDL_DYNAPI_PROC
+#undef SDL_DYNAPI_PROC_NO_VARARGS
+        atexit(LogLazyBinding);
+    }
+
+    if (IsWindows()) WrapCallbacks();
 
     return 0;
 }
@@ -344,52 +1028,773 @@ SDL_CosmoGetError(void) {
 }
 
 /* wrappers over procedures that use callbacks */
-struct audio_callback_userdata {
+
+/* native code calls back into us with its own calling convention. on sysv
+ * hosts that is ours already, so callbacks are handed over untouched. on
+ * windows, the procedures taking callbacks get wrapped in the jump table: an
+ * ms_abi trampoline is registered instead of the callback, and it gets a slot
+ * recording the real callback as its userdata. slots live in fixed pools and
+ * are claimed and released without locks, so registering callbacks over and
+ * over doesn't grow memory */
+struct callback_slot {
+  int busy;
+  int pending, expired; /* timers only */
+  Uint32 key;
+  void *callback;
   void *userdata;
-  void (*callback)(void*,Uint8*,int);
+  char *name; /* hints only */
 };
 
+static struct callback_slot *
+acquire_slot(struct callback_slot *slots, int n, void *callback, void *userdata) {
+  int i;
+  for (i = 0; i < n; i++)
+    if (!__atomic_exchange_n(&slots[i].busy, 1, __ATOMIC_ACQUIRE)) {
+      slots[i].callback = callback;
+      slots[i].userdata = userdata;
+      return &slots[i];
+    }
+  SDL_SetError("too many callbacks registered");
+  return NULL;
+}
+
+static struct callback_slot *
+find_slot(struct callback_slot *slots, int n, Uint32 key) {
+  int i;
+  for (i = 0; i < n; i++)
+    if (__atomic_load_n(&slots[i].busy, __ATOMIC_ACQUIRE) && slots[i].key == key)
+      return &slots[i];
+  return NULL;
+}
+
+static struct callback_slot *
+find_callback(struct callback_slot *slots, int n, void *callback, void *userdata) {
+  int i;
+  for (i = 0; i < n; i++)
+    if (__atomic_load_n(&slots[i].busy, __ATOMIC_ACQUIRE) &&
+        slots[i].callback == callback && slots[i].userdata == userdata)
+      return &slots[i];
+  return NULL;
+}
+
+/* like SDL, hint callbacks are told apart by the hint they watch too */
+static struct callback_slot *
+find_hint(struct callback_slot *slots, int n, const char *name, void *callback, void *userdata) {
+  int i;
+  for (i = 0; i < n; i++)
+    if (__atomic_load_n(&slots[i].busy, __ATOMIC_ACQUIRE) &&
+        slots[i].callback == callback && slots[i].userdata == userdata &&
+        slots[i].name && !strcmp(slots[i].name, name))
+      return &slots[i];
+  return NULL;
+}
+
 static void
-audio_callback_sysv(void *opaque, Uint8 *stream, int len) {
-  struct audio_callback_userdata *wrapper = opaque;
-  wrapper->callback(wrapper->userdata, stream, len);
+release_slot(struct callback_slot *slot) {
+  if (!slot) return;
+  free(slot->name);
+  slot->name = NULL;
+  slot->key = 0;
+  slot->callback = NULL;
+  slot->userdata = NULL;
+  __atomic_store_n(&slot->busy, 0, __ATOMIC_RELEASE);
 }
 
-static void __attribute__((__ms_abi__))
-audio_callback_ms(void *opaque, Uint8 *stream, int len) {
-  audio_callback_sysv(opaque, stream, len);
+/* generates the ms_abi trampoline for a callback type. params must name
+ * the userdata parameter userdata, and args pass slot->userdata for it */
+#define SDL_COSMO_CALLBACK(name, rc, params, args, ret)                    \
+    static rc __attribute__((__ms_abi__)) name##_ms params                 \
+    {                                                                      \
+        struct callback_slot *slot = userdata;                             \
+        ret ((rc (*) params)slot->callback) args;                          \
+    }
+
+SDL_COSMO_CALLBACK(audio_callback, void,
+    (void *userdata, Uint8 *stream, int len),
+    (slot->userdata, stream, len), )
+SDL_COSMO_CALLBACK(event_filter, int,
+    (void *userdata, SDL_Event *event),
+    (slot->userdata, event), return)
+SDL_COSMO_CALLBACK(hint_callback, void,
+    (void *userdata, const char *name, const char *oldValue, const char *newValue),
+    (slot->userdata, name, oldValue, newValue), )
+SDL_COSMO_CALLBACK(log_output, void,
+    (void *userdata, int category, SDL_LogPriority priority, const char *message),
+    (slot->userdata, category, priority, message), )
+
+/* a timer slot is released once it has been keyed by SDL_AddTimer and the
+ * timer is gone, either cancelled by returning 0 or by SDL_RemoveTimer. the
+ * timer can fire before SDL_AddTimer has returned, so either may come last */
+static void
+timer_put(struct callback_slot *slot) {
+  if (!__atomic_sub_fetch(&slot->pending, 1, __ATOMIC_ACQ_REL))
+    release_slot(slot);
+}
+
+static void
+timer_expire(struct callback_slot *slot) {
+  if (!__atomic_exchange_n(&slot->expired, 1, __ATOMIC_ACQ_REL))
+    timer_put(slot);
+}
+
+static Uint32 __attribute__((__ms_abi__))
+timer_callback_ms(Uint32 interval, void *userdata) {
+  struct callback_slot *slot = userdata;
+  Uint32 next = ((SDL_TimerCallback)slot->callback)(interval, slot->userdata);
+  if (!next) timer_expire(slot);
+  return next;
+}
+
+/* threads only need their slot until they start */
+static int __attribute__((__ms_abi__))
+thread_function_ms(void *userdata) {
+  struct callback_slot *slot = userdata;
+  SDL_ThreadFunction fn = (SDL_ThreadFunction)slot->callback;
+  void *data = slot->userdata;
+  release_slot(slot);
+  return fn(data);
 }
 
-#undef SDL_OpenAudioDevice
-SDL_AudioDeviceID SDL_OpenAudioDevice(
+/* sixteen devices with callbacks at once ought to be plenty */
+#define AUDIO_CALLBACK_SLOTS 16
+#define EVENT_FILTER_SLOTS 4
+#define EVENT_WATCH_SLOTS 32
+#define HINT_CALLBACK_SLOTS 32
+#define LOG_OUTPUT_SLOTS 2
+#define TIMER_CALLBACK_SLOTS 64
+#define THREAD_FUNCTION_SLOTS 16
+
+static struct callback_slot audio_slots[AUDIO_CALLBACK_SLOTS];
+static struct callback_slot filter_slots[EVENT_FILTER_SLOTS];
+static struct callback_slot watch_slots[EVENT_WATCH_SLOTS];
+static struct callback_slot hint_slots[HINT_CALLBACK_SLOTS];
+static struct callback_slot log_slots[LOG_OUTPUT_SLOTS];
+static struct callback_slot timer_slots[TIMER_CALLBACK_SLOTS];
+static struct callback_slot thread_slots[THREAD_FUNCTION_SLOTS];
+
+static struct callback_slot *event_filter_slot;
+static struct callback_slot *log_output_slot;
+
+static SDL_AudioDeviceID SDLCALL
+SDL_OpenAudioDevice_WRAP(
     const char *device,
     int iscapture,
     const SDL_AudioSpec *desired,
     SDL_AudioSpec *obtained,
     int allowed_changes)
 {
-  struct audio_callback_userdata *wrapper;
+  struct callback_slot *slot = NULL;
   SDL_AudioDeviceID result;
   SDL_AudioSpec true_desired;
 
   true_desired = *desired;
   if (desired->callback) {
-    /* FIXME: this leaks memory */
-    wrapper = malloc(sizeof *wrapper);
-    if (!wrapper) {
-      SDL_SetError("out of memory");
-      return 0;
-    }
-    wrapper->userdata = desired->userdata;
-    true_desired.userdata = wrapper;
-    wrapper->callback = desired->callback;
-    if (IsWindows()) true_desired.callback = (void*)audio_callback_ms;
-    else true_desired.callback = audio_callback_sysv;
+    slot = acquire_slot(audio_slots, AUDIO_CALLBACK_SLOTS,
+        (void *)desired->callback, desired->userdata);
+    if (!slot) return 0;
+    true_desired.callback = (SDL_AudioCallback)audio_callback_ms;
+    true_desired.userdata = slot;
+  }
+
+  result = SDL_OpenAudioDevice_MS(device, iscapture, &true_desired, obtained, allowed_changes);
+  if (slot) {
+    if (result) slot->key = result;
+    else release_slot(slot);
+  }
+  if (obtained) {
+    obtained->callback = desired->callback;
+    obtained->userdata = desired->userdata;
   }
+  return result;
+}
+
+static void SDLCALL
+SDL_CloseAudioDevice_WRAP(SDL_AudioDeviceID dev)
+{
+  struct callback_slot *slot;
+
+  slot = find_slot(audio_slots, AUDIO_CALLBACK_SLOTS, dev);
+  /* the callback is guaranteed to not be running anymore after this */
+  SDL_CloseAudioDevice_MS(dev);
+  release_slot(slot);
+}
+
+static SDL_TimerID SDLCALL
+SDL_AddTimer_WRAP(Uint32 interval, SDL_TimerCallback callback, void *param)
+{
+  struct callback_slot *slot;
+  SDL_TimerID result;
 
-  result = SDL_OpenAudioDevice_REAL(device, iscapture, &true_desired, obtained, allowed_changes);
-  if (result == 0) {
-    free(wrapper);
+  slot = acquire_slot(timer_slots, TIMER_CALLBACK_SLOTS, (void *)callback, param);
+  if (!slot) return 0;
+  slot->pending = 2;
+  slot->expired = 0;
+  result = SDL_AddTimer_MS(interval, (SDL_TimerCallback)timer_callback_ms, slot);
+  if (result) {
+    slot->key = result;
+    timer_put(slot);
+  } else {
+    release_slot(slot);
   }
   return result;
 }
+
+static SDL_bool SDLCALL
+SDL_RemoveTimer_WRAP(SDL_TimerID id)
+{
+  struct callback_slot *slot;
+  SDL_bool result;
+
+  /* like with its param, SDL doesn't wait for a running callback here */
+  slot = find_slot(timer_slots, TIMER_CALLBACK_SLOTS, id);
+  result = SDL_RemoveTimer_MS(id);
+  if (slot) timer_expire(slot);
+  return result;
+}
+
+static SDL_Thread *SDLCALL
+SDL_CreateThread_WRAP(SDL_ThreadFunction fn, const char *name, void *data)
+{
+  struct callback_slot *slot;
+  SDL_Thread *result;
+
+  slot = acquire_slot(thread_slots, THREAD_FUNCTION_SLOTS, (void *)fn, data);
+  if (!slot) return NULL;
+  result = SDL_CreateThread_MS((SDL_ThreadFunction)thread_function_ms, name, slot);
+  if (!result) release_slot(slot);
+  return result;
+}
+
+static SDL_Thread *SDLCALL
+SDL_CreateThreadWithStackSize_WRAP(SDL_ThreadFunction fn, const char *name, const size_t stacksize, void *data)
+{
+  struct callback_slot *slot;
+  SDL_Thread *result;
+
+  slot = acquire_slot(thread_slots, THREAD_FUNCTION_SLOTS, (void *)fn, data);
+  if (!slot) return NULL;
+  result = SDL_CreateThreadWithStackSize_MS((SDL_ThreadFunction)thread_function_ms, name, stacksize, slot);
+  if (!result) release_slot(slot);
+  return result;
+}
+
+static void SDLCALL
+SDL_SetEventFilter_WRAP(SDL_EventFilter filter, void *userdata)
+{
+  struct callback_slot *slot = NULL, *old;
+
+  if (filter) {
+    slot = acquire_slot(filter_slots, EVENT_FILTER_SLOTS, (void *)filter, userdata);
+    if (!slot) return;
+    SDL_SetEventFilter_MS((SDL_EventFilter)event_filter_ms, slot);
+  } else {
+    SDL_SetEventFilter_MS(NULL, NULL);
+  }
+  old = __atomic_exchange_n(&event_filter_slot, slot, __ATOMIC_ACQ_REL);
+  release_slot(old);
+}
+
+static SDL_bool SDLCALL
+SDL_GetEventFilter_WRAP(SDL_EventFilter *filter, void **userdata)
+{
+  SDL_EventFilter native_filter;
+  void *native_userdata;
+  struct callback_slot *slot;
+
+  if (!SDL_GetEventFilter_MS(&native_filter, &native_userdata)) return SDL_FALSE;
+  if (native_filter == (SDL_EventFilter)event_filter_ms) {
+    slot = native_userdata;
+    native_filter = (SDL_EventFilter)slot->callback;
+    native_userdata = slot->userdata;
+  }
+  if (filter) *filter = native_filter;
+  if (userdata) *userdata = native_userdata;
+  return SDL_TRUE;
+}
+
+static void SDLCALL
+SDL_AddEventWatch_WRAP(SDL_EventFilter filter, void *userdata)
+{
+  struct callback_slot *slot;
+
+  slot = acquire_slot(watch_slots, EVENT_WATCH_SLOTS, (void *)filter, userdata);
+  if (!slot) return;
+  SDL_AddEventWatch_MS((SDL_EventFilter)event_filter_ms, slot);
+}
+
+static void SDLCALL
+SDL_DelEventWatch_WRAP(SDL_EventFilter filter, void *userdata)
+{
+  struct callback_slot *slot;
+
+  slot = find_callback(watch_slots, EVENT_WATCH_SLOTS, (void *)filter, userdata);
+  if (!slot) return;
+  SDL_DelEventWatch_MS((SDL_EventFilter)event_filter_ms, slot);
+  release_slot(slot);
+}
+
+static void SDLCALL
+SDL_FilterEvents_WRAP(SDL_EventFilter filter, void *userdata)
+{
+  struct callback_slot *slot;
+
+  slot = acquire_slot(filter_slots, EVENT_FILTER_SLOTS, (void *)filter, userdata);
+  if (!slot) return;
+  SDL_FilterEvents_MS((SDL_EventFilter)event_filter_ms, slot);
+  release_slot(slot);
+}
+
+static void SDLCALL
+SDL_AddHintCallback_WRAP(const char *name, SDL_HintCallback callback, void *userdata)
+{
+  struct callback_slot *slot;
+
+  if (!name || !*name) return;
+  slot = acquire_slot(hint_slots, HINT_CALLBACK_SLOTS, (void *)callback, userdata);
+  if (!slot) return;
+  if (!(slot->name = strdup(name))) {
+    release_slot(slot);
+    SDL_OutOfMemory();
+    return;
+  }
+  SDL_AddHintCallback_MS(name, (SDL_HintCallback)hint_callback_ms, slot);
+}
+
+static void SDLCALL
+SDL_DelHintCallback_WRAP(const char *name, SDL_HintCallback callback, void *userdata)
+{
+  struct callback_slot *slot;
+
+  if (!name || !*name) return;
+  slot = find_hint(hint_slots, HINT_CALLBACK_SLOTS, name, (void *)callback, userdata);
+  if (!slot) return;
+  SDL_DelHintCallback_MS(name, (SDL_HintCallback)hint_callback_ms, slot);
+  release_slot(slot);
+}
+
+static void SDLCALL
+SDL_LogSetOutputFunction_WRAP(SDL_LogOutputFunction callback, void *userdata)
+{
+  struct callback_slot *slot, *old;
+
+  slot = acquire_slot(log_slots, LOG_OUTPUT_SLOTS, (void *)callback, userdata);
+  if (!slot) return;
+  SDL_LogSetOutputFunction_MS((SDL_LogOutputFunction)log_output_ms, slot);
+  old = __atomic_exchange_n(&log_output_slot, slot, __ATOMIC_ACQ_REL);
+  release_slot(old);
+}
+
+static void SDLCALL
+SDL_LogGetOutputFunction_WRAP(SDL_LogOutputFunction *callback, void **userdata)
+{
+  SDL_LogOutputFunction native_callback;
+  void *native_userdata;
+  struct callback_slot *slot;
+
+  SDL_LogGetOutputFunction_MS(&native_callback, &native_userdata);
+  if (native_callback == (SDL_LogOutputFunction)log_output_ms) {
+    slot = native_userdata;
+    native_callback = (SDL_LogOutputFunction)slot->callback;
+    native_userdata = slot->userdata;
+  }
+  if (callback) *callback = native_callback;
+  if (userdata) *userdata = native_userdata;
+}
+
+#define SDL_COSMO_WRAPPED_PROCS                 \
+    SDL_COSMO_WRAP(SDL_OpenAudioDevice)         \
+    SDL_COSMO_WRAP(SDL_CloseAudioDevice)        \
+    SDL_COSMO_WRAP(SDL_AddTimer)                \
+    SDL_COSMO_WRAP(SDL_RemoveTimer)             \
+    SDL_COSMO_WRAP(SDL_CreateThread)            \
+    SDL_COSMO_WRAP(SDL_CreateThreadWithStackSize) \
+    SDL_COSMO_WRAP(SDL_SetEventFilter)          \
+    SDL_COSMO_WRAP(SDL_GetEventFilter)          \
+    SDL_COSMO_WRAP(SDL_AddEventWatch)           \
+    SDL_COSMO_WRAP(SDL_DelEventWatch)           \
+    SDL_COSMO_WRAP(SDL_FilterEvents)            \
+    SDL_COSMO_WRAP(SDL_AddHintCallback)         \
+    SDL_COSMO_WRAP(SDL_DelHintCallback)         \
+    SDL_COSMO_WRAP(SDL_LogSetOutputFunction)    \
+    SDL_COSMO_WRAP(SDL_LogGetOutputFunction)
+
+/* the wrappers call straight into the thunks, so what they wrap has to be
+ * bound before they go into the jump table */
+static void WrapCallbacks(void)
+{
+#define SDL_COSMO_WRAP(fn)                                                 \
+    BindProc(#fn, &native_table.fn.ptr, (void *)fn##_MS,                   \
+        &jump_table.fn.ptr);                                               \
+    jump_table.fn.sysv_abi = fn##_WRAP;
+    SDL_COSMO_WRAPPED_PROCS
+#undef SDL_COSMO_WRAP
+}
+
+/* batched rendering */
+
+/* a batch records render calls into a growable arena of packed records and
+ * replays them in order on submit, calling straight through the jump table.
+ * draw calls of the same kind on the same renderer are merged into the tail
+ * record as they are recorded, so a run of SDL_RenderDrawPoint or
+ * SDL_RenderFillRect calls crosses into native code only once on replay */
+enum {
+  BATCH_SET_DRAW_COLOR,
+  BATCH_CLEAR,
+  BATCH_COPY,
+  BATCH_COPY_EX,
+  BATCH_DRAW_POINTS,
+  BATCH_DRAW_LINE,
+  BATCH_DRAW_RECTS,
+  BATCH_FILL_RECTS,
+  BATCH_UPDATE_TEXTURE,
+};
+
+#define BATCH_HAS_SRC 1
+#define BATCH_HAS_DST 2
+#define BATCH_HAS_CENTER 4
+#define BATCH_HAS_RECT 8
+
+struct batch_op {
+  int op;
+  int size; /* of the whole record, a multiple of 8 */
+  SDL_Renderer *renderer;
+};
+
+struct batch_color {
+  struct batch_op hdr;
+  Uint8 r, g, b, a;
+};
+
+struct batch_copy {
+  struct batch_op hdr;
+  SDL_Texture *texture;
+  int flags;
+  SDL_Rect src, dst;
+  SDL_RendererFlip flip;
+  SDL_Point center;
+  double angle;
+};
+
+struct batch_line {
+  struct batch_op hdr;
+  int x1, y1, x2, y2;
+};
+
+/* a rects record with no rects stands for a NULL rect, the whole target */
+struct batch_shapes {
+  struct batch_op hdr;
+  int count;
+  union {
+    SDL_Point points[1];
+    SDL_Rect rects[1];
+  } u;
+};
+
+struct batch_texture {
+  struct batch_op hdr;
+  SDL_Texture *texture;
+  int flags;
+  SDL_Rect rect;
+  const void *pixels;
+  int pitch;
+};
+
+struct SDL_CosmoBatch {
+  unsigned char *arena;
+  size_t used, capacity;
+  size_t tail; /* offset of the last record */
+};
+
+#define BATCH_ALIGN(n) (((n) + 7) & ~(size_t)7)
+#define BATCH_SHAPES_SIZE(n, type) \
+    BATCH_ALIGN(offsetof(struct batch_shapes, u) + (n) * sizeof(type))
+
+static int
+batch_reserve(SDL_CosmoBatch *batch, size_t size) {
+  size_t capacity;
+  unsigned char *arena;
+  if (batch->used + size <= batch->capacity) return 0;
+  capacity = batch->capacity ? batch->capacity : 4096;
+  while (capacity < batch->used + size) capacity *= 2;
+  if (!(arena = realloc(batch->arena, capacity))) return SDL_OutOfMemory();
+  batch->arena = arena;
+  batch->capacity = capacity;
+  return 0;
+}
+
+static void *
+batch_push(SDL_CosmoBatch *batch, int op, size_t size, SDL_Renderer *renderer) {
+  struct batch_op *hdr;
+  size = BATCH_ALIGN(size);
+  if (batch_reserve(batch, size)) return NULL;
+  hdr = (struct batch_op *)(batch->arena + batch->used);
+  hdr->op = op;
+  hdr->size = size;
+  hdr->renderer = renderer;
+  batch->tail = batch->used;
+  batch->used += size;
+  return hdr;
+}
+
+/* appends n shapes to the tail record if it can take them, else starts a new
+ * one. returns where the shapes go */
+static void *
+batch_shapes(SDL_CosmoBatch *batch, int op, SDL_Renderer *renderer, int n, size_t shape) {
+  struct batch_shapes *rec;
+  size_t size, grown;
+  if (batch->used) {
+    rec = (struct batch_shapes *)(batch->arena + batch->tail);
+    if (rec->hdr.op == op && rec->hdr.renderer == renderer && rec->count) {
+      size = offsetof(struct batch_shapes, u) + rec->count * shape;
+      grown = BATCH_ALIGN(size + n * shape);
+      if (grown > (size_t)rec->hdr.size) {
+        if (batch_reserve(batch, grown - rec->hdr.size)) return NULL;
+        rec = (struct batch_shapes *)(batch->arena + batch->tail);
+        batch->used += grown - rec->hdr.size;
+        rec->hdr.size = grown;
+      }
+      rec->count += n;
+      return (unsigned char *)rec + size;
+    }
+  }
+  rec = batch_push(batch, op, offsetof(struct batch_shapes, u) + n * shape, renderer);
+  if (!rec) return NULL;
+  rec->count = n;
+  return &rec->u;
+}
+
+SDL_CosmoBatch *
+SDL_CosmoBatchCreate(void) {
+  SDL_CosmoBatch *batch = calloc(1, sizeof(*batch));
+  if (!batch) SDL_OutOfMemory();
+  return batch;
+}
+
+void
+SDL_CosmoBatchDestroy(SDL_CosmoBatch *batch) {
+  if (!batch) return;
+  free(batch->arena);
+  free(batch);
+}
+
+void
+SDL_CosmoBatchBegin(SDL_CosmoBatch *batch) {
+  batch->used = 0;
+  batch->tail = 0;
+}
+
+int
+SDL_CosmoBatchSetRenderDrawColor(SDL_CosmoBatch *batch, SDL_Renderer *renderer,
+                                 Uint8 r, Uint8 g, Uint8 b, Uint8 a) {
+  struct batch_color *rec;
+  if (!(rec = batch_push(batch, BATCH_SET_DRAW_COLOR, sizeof(*rec), renderer)))
+    return -1;
+  rec->r = r;
+  rec->g = g;
+  rec->b = b;
+  rec->a = a;
+  return 0;
+}
+
+int
+SDL_CosmoBatchRenderClear(SDL_CosmoBatch *batch, SDL_Renderer *renderer) {
+  return batch_push(batch, BATCH_CLEAR, sizeof(struct batch_op), renderer) ? 0 : -1;
+}
+
+static struct batch_copy *
+batch_copy(SDL_CosmoBatch *batch, int op, SDL_Renderer *renderer, SDL_Texture *texture,
+           const SDL_Rect *srcrect, const SDL_Rect *dstrect) {
+  struct batch_copy *rec;
+  if (!(rec = batch_push(batch, op, sizeof(*rec), renderer))) return NULL;
+  rec->texture = texture;
+  rec->flags = 0;
+  if (srcrect) {
+    rec->src = *srcrect;
+    rec->flags |= BATCH_HAS_SRC;
+  }
+  if (dstrect) {
+    rec->dst = *dstrect;
+    rec->flags |= BATCH_HAS_DST;
+  }
+  return rec;
+}
+
+int
+SDL_CosmoBatchRenderCopy(SDL_CosmoBatch *batch, SDL_Renderer *renderer, SDL_Texture *texture,
+                         const SDL_Rect *srcrect, const SDL_Rect *dstrect) {
+  return batch_copy(batch, BATCH_COPY, renderer, texture, srcrect, dstrect) ? 0 : -1;
+}
+
+int
+SDL_CosmoBatchRenderCopyEx(SDL_CosmoBatch *batch, SDL_Renderer *renderer, SDL_Texture *texture,
+                           const SDL_Rect *srcrect, const SDL_Rect *dstrect,
+                           double angle, const SDL_Point *center, SDL_RendererFlip flip) {
+  struct batch_copy *rec;
+  if (!(rec = batch_copy(batch, BATCH_COPY_EX, renderer, texture, srcrect, dstrect)))
+    return -1;
+  rec->angle = angle;
+  rec->flip = flip;
+  if (center) {
+    rec->center = *center;
+    rec->flags |= BATCH_HAS_CENTER;
+  }
+  return 0;
+}
+
+int
+SDL_CosmoBatchRenderDrawPoint(SDL_CosmoBatch *batch, SDL_Renderer *renderer, int x, int y) {
+  SDL_Point *point;
+  if (!(point = batch_shapes(batch, BATCH_DRAW_POINTS, renderer, 1, sizeof(*point))))
+    return -1;
+  point->x = x;
+  point->y = y;
+  return 0;
+}
+
+int
+SDL_CosmoBatchRenderDrawPoints(SDL_CosmoBatch *batch, SDL_Renderer *renderer,
+                               const SDL_Point *points, int count) {
+  SDL_Point *dst;
+  if (count <= 0) return 0;
+  if (!(dst = batch_shapes(batch, BATCH_DRAW_POINTS, renderer, count, sizeof(*dst))))
+    return -1;
+  memcpy(dst, points, count * sizeof(*dst));
+  return 0;
+}
+
+int
+SDL_CosmoBatchRenderDrawLine(SDL_CosmoBatch *batch, SDL_Renderer *renderer,
+                             int x1, int y1, int x2, int y2) {
+  struct batch_line *rec;
+  if (!(rec = batch_push(batch, BATCH_DRAW_LINE, sizeof(*rec), renderer))) return -1;
+  rec->x1 = x1;
+  rec->y1 = y1;
+  rec->x2 = x2;
+  rec->y2 = y2;
+  return 0;
+}
+
+static int
+batch_rects(SDL_CosmoBatch *batch, int op, SDL_Renderer *renderer,
+            const SDL_Rect *rects, int count) {
+  struct batch_shapes *rec;
+  SDL_Rect *dst;
+  if (!rects) { /* the whole target, never merged */
+    if (!(rec = batch_push(batch, op, BATCH_SHAPES_SIZE(0, SDL_Rect), renderer))) return -1;
+    rec->count = 0;
+    return 0;
+  }
+  if (count <= 0) return 0;
+  if (!(dst = batch_shapes(batch, op, renderer, count, sizeof(*dst)))) return -1;
+  memcpy(dst, rects, count * sizeof(*dst));
+  return 0;
+}
+
+int
+SDL_CosmoBatchRenderDrawRect(SDL_CosmoBatch *batch, SDL_Renderer *renderer, const SDL_Rect *rect) {
+  return batch_rects(batch, BATCH_DRAW_RECTS, renderer, rect, 1);
+}
+
+int
+SDL_CosmoBatchRenderDrawRects(SDL_CosmoBatch *batch, SDL_Renderer *renderer,
+                              const SDL_Rect *rects, int count) {
+  if (!rects) return 0;
+  return batch_rects(batch, BATCH_DRAW_RECTS, renderer, rects, count);
+}
+
+int
+SDL_CosmoBatchRenderFillRect(SDL_CosmoBatch *batch, SDL_Renderer *renderer, const SDL_Rect *rect) {
+  return batch_rects(batch, BATCH_FILL_RECTS, renderer, rect, 1);
+}
+
+int
+SDL_CosmoBatchRenderFillRects(SDL_CosmoBatch *batch, SDL_Renderer *renderer,
+                              const SDL_Rect *rects, int count) {
+  if (!rects) return 0;
+  return batch_rects(batch, BATCH_FILL_RECTS, renderer, rects, count);
+}
+
+int
+SDL_CosmoBatchUpdateTexture(SDL_CosmoBatch *batch, SDL_Texture *texture, const SDL_Rect *rect,
+                            const void *pixels, int pitch) {
+  struct batch_texture *rec;
+  if (!(rec = batch_push(batch, BATCH_UPDATE_TEXTURE, sizeof(*rec), NULL))) return -1;
+  rec->texture = texture;
+  rec->flags = 0;
+  if (rect) {
+    rec->rect = *rect;
+    rec->flags |= BATCH_HAS_RECT;
+  }
+  rec->pixels = pixels;
+  rec->pitch = pitch;
+  return 0;
+}
+
+int
+SDL_CosmoBatchSubmit(SDL_CosmoBatch *batch) {
+  unsigned char *p = batch->arena, *end = batch->arena + batch->used;
+  struct batch_op *hdr;
+  struct batch_copy *copy;
+  struct batch_shapes *shapes;
+  struct batch_texture *tex;
+  struct batch_color *color;
+  struct batch_line *line;
+  int rc = 0;
+
+  for (; p < end; p += hdr->size) {
+    hdr = (struct batch_op *)p;
+    switch (hdr->op) {
+    case BATCH_SET_DRAW_COLOR:
+      color = (struct batch_color *)hdr;
+      rc |= jump_table.SDL_SetRenderDrawColor.sysv_abi(hdr->renderer, color->r, color->g,
+                                                       color->b, color->a);
+      break;
+    case BATCH_CLEAR:
+      rc |= jump_table.SDL_RenderClear.sysv_abi(hdr->renderer);
+      break;
+    case BATCH_COPY:
+      copy = (struct batch_copy *)hdr;
+      rc |= jump_table.SDL_RenderCopy.sysv_abi(hdr->renderer, copy->texture,
+          copy->flags & BATCH_HAS_SRC ? &copy->src : NULL,
+          copy->flags & BATCH_HAS_DST ? &copy->dst : NULL);
+      break;
+    case BATCH_COPY_EX:
+      copy = (struct batch_copy *)hdr;
+      rc |= jump_table.SDL_RenderCopyEx.sysv_abi(hdr->renderer, copy->texture,
+          copy->flags & BATCH_HAS_SRC ? &copy->src : NULL,
+          copy->flags & BATCH_HAS_DST ? &copy->dst : NULL, copy->angle,
+          copy->flags & BATCH_HAS_CENTER ? &copy->center : NULL, copy->flip);
+      break;
+    case BATCH_DRAW_POINTS:
+      shapes = (struct batch_shapes *)hdr;
+      rc |= jump_table.SDL_RenderDrawPoints.sysv_abi(hdr->renderer, shapes->u.points,
+                                                     shapes->count);
+      break;
+    case BATCH_DRAW_LINE:
+      line = (struct batch_line *)hdr;
+      rc |= jump_table.SDL_RenderDrawLine.sysv_abi(hdr->renderer, line->x1, line->y1,
+                                                   line->x2, line->y2);
+      break;
+    case BATCH_DRAW_RECTS:
+      shapes = (struct batch_shapes *)hdr;
+      rc |= shapes->count
+          ? jump_table.SDL_RenderDrawRects.sysv_abi(hdr->renderer, shapes->u.rects, shapes->count)
+          : jump_table.SDL_RenderDrawRect.sysv_abi(hdr->renderer, NULL);
+      break;
+    case BATCH_FILL_RECTS:
+      shapes = (struct batch_shapes *)hdr;
+      rc |= shapes->count
+          ? jump_table.SDL_RenderFillRects.sysv_abi(hdr->renderer, shapes->u.rects, shapes->count)
+          : jump_table.SDL_RenderFillRect.sysv_abi(hdr->renderer, NULL);
+      break;
+    case BATCH_UPDATE_TEXTURE:
+      tex = (struct batch_texture *)hdr;
+      rc |= jump_table.SDL_UpdateTexture.sysv_abi(tex->texture,
+          tex->flags & BATCH_HAS_RECT ? &tex->rect : NULL, tex->pixels, tex->pitch);
+      break;
+    }
+  }
+
+  SDL_CosmoBatchBegin(batch);
+  return rc < 0 ? -1 : 0;
+}
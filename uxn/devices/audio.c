@@ -15,14 +15,6 @@ WITH REGARD TO THIS SOFTWARE.
 #define NOTE_PERIOD (SAMPLE_FREQUENCY * 0x4000 / 11025)
 #define ADSR_STEP (SAMPLE_FREQUENCY / 0xf)
 
-typedef struct {
-	Uint8 *addr;
-	Uint32 count, advance, period, age, a, d, s, r;
-	Uint16 i, len;
-	Sint8 volume[2];
-	Uint8 pitch, repeat;
-} UxnAudio;
-
 /* clang-format off */
 
 static Uint32 advances[12] = {
@@ -119,8 +111,6 @@ static double detunes[256] = {
 1.0592240705916123, 
 };
 
-static UxnAudio uxn_audio[POLYPHONY];
-
 /* clang-format on */
 
 static Sint32
@@ -136,9 +126,8 @@ envelope(UxnAudio *c, Uint32 age)
 }
 
 int
-audio_render(int instance, Sint16 *sample, Sint16 *end)
+audio_render(UxnAudio *c, Sint16 *sample, Sint16 *end)
 {
-	UxnAudio *c = &uxn_audio[instance];
 	Sint32 s;
 	if(!c->advance || !c->period) return 0;
 	while(sample < end) {
@@ -156,14 +145,13 @@ audio_render(int instance, Sint16 *sample, Sint16 *end)
 		*sample++ += s * c->volume[0] / 0x180;
 		*sample++ += s * c->volume[1] / 0x180;
 	}
-	if(!c->advance) audio_finished_handler(instance);
+	if(!c->advance) audio_finished_handler(c);
 	return 1;
 }
 
 void
-audio_start(int instance, Uint8 *d, Uxn *u)
+audio_start(UxnAudio *c, Uint8 *d, Uxn *u)
 {
-	UxnAudio *c = &uxn_audio[instance];
 	Uint8 pitch = d[0xf] & 0x7f;
 	Uint8 detune = d[0x5];
 	Uint16 addr = PEEK2(d + 0xc), adsr = PEEK2(d + 0x8);
@@ -193,9 +181,8 @@ audio_start(int instance, Uint8 *d, Uxn *u)
 }
 
 Uint8
-audio_get_vu(int instance)
+audio_get_vu(UxnAudio *c)
 {
-	UxnAudio *c = &uxn_audio[instance];
 	int i;
 	Sint32 sum[2] = {0, 0};
 	if(!c->advance || !c->period) return 0;
@@ -208,8 +195,44 @@ audio_get_vu(int instance)
 }
 
 Uint16
-audio_get_position(int instance)
+audio_get_position(UxnAudio *c)
 {
-	UxnAudio *c = &uxn_audio[instance];
 	return c->i;
 }
+
+/* Snapshots */
+
+#define POKE4(d, v) { POKE2(d, (v) >> 16) POKE2((d) + 2, v) }
+#define PEEK4(d) ((Uint32)PEEK2(d) << 16 | PEEK2((d) + 2))
+
+void
+audio_save(UxnAudio *c, Uint8 *ram, Uint8 *state)
+{
+	Uint32 *v[] = {&c->count, &c->advance, &c->period, &c->age, &c->a, &c->d, &c->s, &c->r};
+	int i;
+	POKE2(state, c->addr ? c->addr - ram : 0)
+	for(i = 0; i < 8; i++)
+		POKE4(state + 2 + i * 4, *v[i])
+	POKE2(state + 34, c->i)
+	POKE2(state + 36, c->len)
+	state[38] = c->volume[0];
+	state[39] = c->volume[1];
+	state[40] = c->pitch;
+	state[41] = c->repeat;
+}
+
+void
+audio_load(UxnAudio *c, Uint8 *ram, Uint8 *state)
+{
+	Uint32 *v[] = {&c->count, &c->advance, &c->period, &c->age, &c->a, &c->d, &c->s, &c->r};
+	int i;
+	c->addr = &ram[PEEK2(state)];
+	for(i = 0; i < 8; i++)
+		*v[i] = PEEK4(state + 2 + i * 4);
+	c->i = PEEK2(state + 34);
+	c->len = PEEK2(state + 36);
+	c->volume[0] = state[38];
+	c->volume[1] = state[39];
+	c->pitch = state[40];
+	c->repeat = state[41];
+}
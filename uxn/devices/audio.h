@@ -18,8 +18,21 @@ typedef signed int Sint32;
 #define SAMPLE_FREQUENCY 44100
 #define POLYPHONY 4
 
-Uint8 audio_get_vu(int instance);
-Uint16 audio_get_position(int instance);
-int audio_render(int instance, Sint16 *sample, Sint16 *end);
-void audio_start(int instance, Uint8 *d, Uxn *u);
-void audio_finished_handler(int instance);
+typedef struct {
+	Uint8 *addr;
+	Uint32 count, advance, period, age, a, d, s, r;
+	Uint16 i, len;
+	Sint8 volume[2];
+	Uint8 pitch, repeat;
+} UxnAudio;
+
+Uint8 audio_get_vu(UxnAudio *c);
+Uint16 audio_get_position(UxnAudio *c);
+int audio_render(UxnAudio *c, Sint16 *sample, Sint16 *end);
+void audio_start(UxnAudio *c, Uint8 *d, Uxn *u);
+void audio_finished_handler(UxnAudio *c);
+
+#define AUDIO_SNAPSHOT 42
+
+void audio_save(UxnAudio *c, Uint8 *ram, Uint8 *state);
+void audio_load(UxnAudio *c, Uint8 *ram, Uint8 *state);
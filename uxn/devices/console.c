@@ -25,16 +25,16 @@ console_input(Uxn *u, char c, int type)
 }
 
 void
-console_deo(Uint8 *d, Uint8 port)
+console_deo(Uint8 *d, Uint8 port, FILE *out, FILE *err)
 {
 	switch(port) {
 	case 0x8:
-		fputc(d[port], stdout);
-		fflush(stdout);
+		fputc(d[port], out);
+		fflush(out);
 		return;
 	case 0x9:
-		fputc(d[port], stderr);
-		fflush(stderr);
+		fputc(d[port], err);
+		fflush(err);
 		return;
 	}
 }
\ No newline at end of file
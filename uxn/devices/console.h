@@ -18,5 +18,7 @@ WITH REGARD TO THIS SOFTWARE.
 #define CONSOLE_EOA 0x3
 #define CONSOLE_END 0x4
 
+#include <stdio.h>
+
 int console_input(Uxn *u, char c, int type);
-void console_deo(Uint8 *d, Uint8 port);
+void console_deo(Uint8 *d, Uint8 port, FILE *out, FILE *err);
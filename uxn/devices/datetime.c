@@ -14,12 +14,19 @@ THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
 WITH REGARD TO THIS SOFTWARE.
 */
 
+/* localtime returns a buffer shared by all threads, and machines may run on
+several at once */
+
+#ifdef _WIN32
+#define localtime_r(seconds, tm) (localtime_s((tm), (seconds)) ? NULL : (tm))
+#endif
+
 Uint8
 datetime_dei(Uxn *u, Uint8 addr)
 {
 	time_t seconds = time(NULL);
-	struct tm zt = {0};
-	struct tm *t = localtime(&seconds);
+	struct tm zt = {0}, tm;
+	struct tm *t = localtime_r(&seconds, &tm);
 	if(t == NULL)
 		t = &zt;
 	switch(addr) {
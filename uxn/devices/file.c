@@ -40,22 +40,8 @@ THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
 WITH REGARD TO THIS SOFTWARE.
 */
 
-typedef struct {
-	FILE *f;
-	DIR *dir;
-	char current_filename[4096];
-	struct dirent *de;
-	enum { IDLE,
-		FILE_READ,
-		FILE_WRITE,
-		DIR_READ } state;
-	int outside_sandbox;
-} UxnFile;
-
-static UxnFile uxn_file[POLYFILEY];
-
-static void
-reset(UxnFile *c)
+void
+file_reset(UxnFile *c)
 {
 	if(c->f != NULL) {
 		fclose(c->f);
@@ -89,8 +75,7 @@ get_entry(char *p, Uint16 len, const char *pathname, const char *basename, int f
 static Uint16
 file_read_dir(UxnFile *c, char *dest, Uint16 len)
 {
-	static char pathname[4352];
-	char *p = dest;
+	char pathname[4352], *p = dest;
 	if(c->de == NULL) c->de = readdir(c->dir);
 	for(; c->de != NULL; c->de = readdir(c->dir)) {
 		Uint16 n;
@@ -175,7 +160,7 @@ file_init(UxnFile *c, char *filename, size_t max_len, int override_sandbox)
 {
 	char *p = c->current_filename;
 	size_t len = sizeof(c->current_filename);
-	reset(c);
+	file_reset(c);
 	if(len > max_len) len = max_len;
 	while(len) {
 		if((*p++ = *filename++) == '\0') {
@@ -194,7 +179,7 @@ file_read(UxnFile *c, void *dest, int len)
 {
 	if(c->outside_sandbox) return 0;
 	if(c->state != FILE_READ && c->state != DIR_READ) {
-		reset(c);
+		file_reset(c);
 		if((c->dir = opendir(c->current_filename)) != NULL)
 			c->state = DIR_READ;
 		else if((c->f = fopen(c->current_filename, "rb")) != NULL)
@@ -213,7 +198,7 @@ file_write(UxnFile *c, void *src, Uint16 len, Uint8 flags)
 	Uint16 ret = 0;
 	if(c->outside_sandbox) return 0;
 	if(c->state != FILE_WRITE) {
-		reset(c);
+		file_reset(c);
 		if((c->f = fopen(c->current_filename, (flags & 0x01) ? "ab" : "wb")) != NULL)
 			c->state = FILE_WRITE;
 	}
@@ -245,9 +230,9 @@ file_delete(UxnFile *c)
 /* IO */
 
 void
-file_deo(Uint8 id, Uint8 *ram, Uint8 *d, Uint8 port)
+file_deo(UxnFile *c, Uxn *u, Uint8 *d, Uint8 port)
 {
-	UxnFile *c = &uxn_file[id];
+	Uint8 *ram = u->ram;
 	Uint16 addr, len, res;
 	switch(port) {
 	case 0x5:
@@ -256,6 +241,7 @@ file_deo(Uint8 id, Uint8 *ram, Uint8 *d, Uint8 port)
 		if(len > 0x10000 - addr)
 			len = 0x10000 - addr;
 		res = file_stat(c, &ram[addr], len);
+		uxn_invalidate(u, addr, res);
 		POKE2(d + 0x2, res);
 		break;
 	case 0x6:
@@ -273,6 +259,7 @@ file_deo(Uint8 id, Uint8 *ram, Uint8 *d, Uint8 port)
 		if(len > 0x10000 - addr)
 			len = 0x10000 - addr;
 		res = file_read(c, &ram[addr], len);
+		uxn_invalidate(u, addr, res);
 		POKE2(d + 0x2, res);
 		break;
 	case 0xf:
@@ -285,3 +272,43 @@ file_deo(Uint8 id, Uint8 *ram, Uint8 *d, Uint8 port)
 		break;
 	}
 }
+
+/* Snapshots keep the filename, and what was open and where in it. Files are
+opened again on load, directories are read again from the start. */
+
+Uint16
+file_save(UxnFile *c, Uint8 *state, Uint16 len)
+{
+	long pos = c->f ? ftell(c->f) : 0;
+	Uint16 n = strlen(c->current_filename) + 1;
+	if(len < n + 6)
+		return 0;
+	state[0] = c->state;
+	state[1] = c->outside_sandbox;
+	POKE2(state + 2, pos >> 16)
+	POKE2(state + 4, pos)
+	memcpy(state + 6, c->current_filename, n);
+	return n + 6;
+}
+
+void
+file_load(UxnFile *c, Uint8 *state, Uint16 len)
+{
+	long pos = (long)PEEK2(state + 2) << 16 | PEEK2(state + 4);
+	file_reset(c);
+	c->current_filename[0] = '\0';
+	if(len < 7 || state[len - 1] || len - 6 > sizeof(c->current_filename))
+		return;
+	memcpy(c->current_filename, state + 6, len - 6);
+	c->outside_sandbox = state[1];
+	if(c->outside_sandbox)
+		return;
+	if(state[0] == DIR_READ && (c->dir = opendir(c->current_filename)))
+		c->state = DIR_READ;
+	else if(state[0] == FILE_READ && (c->f = fopen(c->current_filename, "rb")))
+		c->state = FILE_READ;
+	else if(state[0] == FILE_WRITE && (c->f = fopen(c->current_filename, "r+b")))
+		c->state = FILE_WRITE;
+	if(c->f)
+		fseek(c->f, pos, SEEK_SET);
+}
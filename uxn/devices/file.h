@@ -16,4 +16,22 @@ WITH REGARD TO THIS SOFTWARE.
 #define POLYFILEY 2
 #define DEV_FILE0 0xa
 
-void file_deo(Uint8 id, Uint8 *ram, Uint8 *d, Uint8 port);
+#include <stdio.h>
+#include <dirent.h>
+
+typedef struct {
+	FILE *f;
+	DIR *dir;
+	char current_filename[4096];
+	struct dirent *de;
+	enum { IDLE,
+		FILE_READ,
+		FILE_WRITE,
+		DIR_READ } state;
+	int outside_sandbox;
+} UxnFile;
+
+void file_reset(UxnFile *c);
+void file_deo(UxnFile *c, Uxn *u, Uint8 *d, Uint8 port);
+Uint16 file_save(UxnFile *c, Uint8 *state, Uint16 len);
+void file_load(UxnFile *c, Uint8 *state, Uint16 len);
@@ -1,8 +1,17 @@
 #include <stdlib.h>
+#include <string.h>
 
 #include "../uxn.h"
 #include "screen.h"
 
+#if defined(__x86_64__) && defined(__GNUC__)
+#define SCREEN_X86
+#include <immintrin.h>
+#endif
+#ifdef __aarch64__
+#include <arm_neon.h>
+#endif
+
 /*
 Copyright (c) 2021-2023 Devine Lu Linvega, Andrew Alderwick
 
@@ -14,8 +23,6 @@ THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
 WITH REGARD TO THIS SOFTWARE.
 */
 
-UxnScreen uxn_screen;
-
 /* c = !ch ? (color % 5 ? color >> 2 : 0) : color % 4 + ch == 1 ? 0 : (ch - 2 + (color & 3)) % 3 + 1; */
 
 static Uint8 blending[4][16] = {
@@ -24,48 +31,137 @@ static Uint8 blending[4][16] = {
 	{1, 2, 3, 1, 1, 2, 3, 1, 1, 2, 3, 1, 1, 2, 3, 1},
 	{2, 3, 1, 2, 2, 3, 1, 2, 2, 3, 1, 2, 2, 3, 1, 2}};
 
+/* Changes are kept by tiles, so that a few sprites far apart on a large screen
+don't have all that is between them redrawn. */
+
 void
-screen_change(Uint16 x1, Uint16 y1, Uint16 x2, Uint16 y2)
+screen_change(UxnScreen *scr, Uint16 x1, Uint16 y1, Uint16 x2, Uint16 y2)
 {
-	if(x1 > uxn_screen.width && x2 > x1) return;
-	if(y1 > uxn_screen.height && y2 > y1) return;
+	int y;
+	if(x1 > scr->width && x2 > x1) return;
+	if(y1 > scr->height && y2 > y1) return;
 	if(x1 > x2) x1 = 0;
 	if(y1 > y2) y1 = 0;
-	if(x1 < uxn_screen.x1) uxn_screen.x1 = x1;
-	if(y1 < uxn_screen.y1) uxn_screen.y1 = y1;
-	if(x2 > uxn_screen.x2) uxn_screen.x2 = x2;
-	if(y2 > uxn_screen.y2) uxn_screen.y2 = y2;
+	if(x2 > scr->width) x2 = scr->width;
+	if(y2 > scr->height) y2 = scr->height;
+	if(x1 >= x2 || y1 >= y2) return;
+	x1 /= SCREEN_TILE, x2 = (x2 - 1) / SCREEN_TILE + 1;
+	for(y = y1 / SCREEN_TILE; y <= (y2 - 1) / SCREEN_TILE; y++)
+		memset(scr->tiles + x1 + y * SCREEN_TILES, 1, x2 - x1);
+	scr->changed = 1;
+}
+
+/* Both layers share a nibble for each pixel, fg << 2 | bg, the even pixels in
+the low nibbles, so that a redraw reads a quarter of what a byte for each
+pixel of each layer took. A layer is named by where its bits are in the
+nibble. */
+
+#define BG 0
+#define FG 2
+#define NIBBLE(layers, i) ((layers)[(i) >> 1] >> ((i) & 1) * 4 & 0xf)
+
+static void
+layer_put(Uint8 *layers, Uint32 i, int layer, int color)
+{
+	Uint8 *p = layers + (i >> 1);
+	int shift = layer + (i & 1) * 4;
+	*p = (*p & ~(0x3 << shift)) | color << shift;
+}
+
+/* sets the pixels from i to end in a layer, a word of 16 pixels at a time */
+
+static void
+layer_span(Uint8 *layers, Uint32 i, Uint32 end, int layer, int color)
+{
+	unsigned long long w, mask = 0x3333333333333333ull << layer, value = 0x1111111111111111ull * color << layer;
+	if(i < end && (i & 1))
+		layer_put(layers, i++, layer, color);
+	for(; i + 16 <= end; i += 16) {
+		memcpy(&w, layers + i / 2, 8);
+		w = (w & ~mask) | value;
+		memcpy(layers + i / 2, &w, 8);
+	}
+	for(; i < end; i++)
+		layer_put(layers, i, layer, color);
+}
+
+static void
+screen_fill(UxnScreen *scr, int layer, int x1, int y1, int x2, int y2, int color)
+{
+	int y, width = scr->width, height = scr->height;
+	if(x2 > width) x2 = width;
+	if(y2 > height) y2 = height;
+	if(x1 >= x2 || y1 >= y2)
+		return;
+	/* whole rows follow each other */
+	if(!x1 && x2 == width) {
+		layer_span(scr->layers, y1 * width, y2 * width, layer, color);
+		return;
+	}
+	for(y = y1; y < y2; y++)
+		layer_span(scr->layers, x1 + y * width, x2 + y * width, layer, color);
 }
 
+/* A byte of a sprite row spread to a nibble for each of its 8 pixels, the
+leftmost pixel in the low nibble, as it is for flipx 0 and 1: a row of 2bpp
+is the first plane spread, or the second spread and shifted by one. */
+
+#define SPREAD(b, f) (((b) >> (0 ^ (f)) & 1) | ((b) >> (1 ^ (f)) & 1) << 4 | ((b) >> (2 ^ (f)) & 1) << 8 | ((b) >> (3 ^ (f)) & 1) << 12 | \
+	((b) >> (4 ^ (f)) & 1) << 16 | ((b) >> (5 ^ (f)) & 1) << 20 | ((b) >> (6 ^ (f)) & 1) << 24 | ((b) >> (7 ^ (f)) & 1) << 28)
+#define SPREAD4(b, f) SPREAD(b, f), SPREAD(b + 1, f), SPREAD(b + 2, f), SPREAD(b + 3, f)
+#define SPREAD16(b, f) SPREAD4(b, f), SPREAD4(b + 4, f), SPREAD4(b + 8, f), SPREAD4(b + 12, f)
+#define SPREAD64(b, f) SPREAD16(b, f), SPREAD16(b + 16, f), SPREAD16(b + 32, f), SPREAD16(b + 48, f)
+
+static Uint32 spread[2][256] = {
+	{SPREAD64(0, 7), SPREAD64(64, 7), SPREAD64(128, 7), SPREAD64(192, 7)},
+	{SPREAD64(0, 0), SPREAD64(64, 0), SPREAD64(128, 0), SPREAD64(192, 0)}};
+
+/* writes a row of 8 pixels from i, with ch in a nibble each, all the nibbles
+blended at once and the transparent ones masked out */
+
 static void
-screen_fill(Uint8 *layer, int x1, int y1, int x2, int y2, int color)
+layer_row(Uint8 *layers, Uint32 i, int layer, Uint32 ch, int color, int opaque)
 {
-	int x, y, width = uxn_screen.width, height = uxn_screen.height;
-	for(y = y1; y < y2 && y < height; y++)
-		for(x = x1; x < x2 && x < width; x++)
-			layer[x + y * width] = color;
+	Uint32 lo = ch & 0x11111111, hi = ch >> 1 & 0x11111111;
+	unsigned long long value, mask;
+	Uint8 *p = layers + (i >> 1);
+	int k, n = 4 + (i & 1), shift = layer + (i & 1) * 4;
+	value = (~(lo | hi) & 0x11111111) * blending[0][color] + (lo & ~hi) * blending[1][color];
+	value += (hi & ~lo) * blending[2][color] + (lo & hi) * blending[3][color];
+	mask = (opaque ? 0x11111111 : lo | hi) * 0x3ull << shift;
+	value = value << shift & mask;
+	for(k = 0; k < n; k++, mask >>= 8, value >>= 8)
+		p[k] = (p[k] & ~mask) | value;
 }
 
 static void
-screen_blit(Uint8 *layer, Uint8 *ram, Uint16 addr, int x1, int y1, int color, int flipx, int flipy, int twobpp)
+screen_blit(UxnScreen *scr, int layer, Uint8 *ram, Uint16 addr, int x1, int y1, int color, int flipx, int flipy, int twobpp)
 {
-	int v, h, width = uxn_screen.width, height = uxn_screen.height, opaque = (color % 5);
+	int v, h, width = scr->width, height = scr->height, opaque = (color % 5);
+	Uint32 *row = spread[!!flipx];
 	for(v = 0; v < 8; v++) {
 		Uint16 c = ram[(addr + v) & 0xffff] | (twobpp ? (ram[(addr + v + 8) & 0xffff] << 8) : 0);
 		Uint16 y = y1 + (flipy ? 7 - v : v);
+		if(y >= height)
+			continue;
+		/* all on screen */
+		if(x1 + 8 <= width) {
+			layer_row(scr->layers, x1 + y * width, layer, row[c & 0xff] | row[c >> 8] << 1, color, opaque);
+			continue;
+		}
 		for(h = 7; h >= 0; --h, c >>= 1) {
 			Uint8 ch = (c & 1) | ((c >> 7) & 2);
 			if(opaque || ch) {
 				Uint16 x = x1 + (flipx ? 7 - h : h);
-				if(x < width && y < height)
-					layer[x + y * width] = blending[ch][color];
+				if(x < width)
+					layer_put(scr->layers, x + y * width, layer, blending[ch][color]);
 			}
 		}
 	}
 }
 
 void
-screen_palette(Uint8 *addr)
+screen_palette(UxnScreen *scr, Uint8 *addr)
 {
 	int i, shift;
 	for(i = 0, shift = 4; i < 4; ++i, shift ^= 4) {
@@ -73,60 +169,275 @@ screen_palette(Uint8 *addr)
 			r = (addr[0 + i / 2] >> shift) & 0xf,
 			g = (addr[2 + i / 2] >> shift) & 0xf,
 			b = (addr[4 + i / 2] >> shift) & 0xf;
-		uxn_screen.palette[i] = 0x0f000000 | r << 16 | g << 8 | b;
-		uxn_screen.palette[i] |= uxn_screen.palette[i] << 4;
+		scr->palette[i] = 0x0f000000 | r << 16 | g << 8 | b;
+		scr->palette[i] |= scr->palette[i] << 4;
 	}
-	screen_change(0, 0, uxn_screen.width, uxn_screen.height);
+	screen_change(scr, 0, 0, scr->width, scr->height);
 }
 
 void
-screen_resize(Uint16 width, Uint16 height)
+screen_resize(UxnScreen *scr, Uint16 width, Uint16 height)
 {
-	Uint8 *bg, *fg;
+	Uint8 *layers;
 	Uint32 *pixels = NULL;
 	if(width < 0x8 || height < 0x8 || width >= 0x400 || height >= 0x400)
 		return;
-	if(uxn_screen.width == width && uxn_screen.height == height)
+	if(scr->width == width && scr->height == height)
 		return;
-	bg = malloc(width * height),
-	fg = malloc(width * height);
-	if(bg && fg)
-		pixels = realloc(uxn_screen.pixels, width * height * sizeof(Uint32));
-	if(!bg || !fg || !pixels) {
-		free(bg);
-		free(fg);
+	layers = calloc((width * height + 1) / 2, 1);
+	if(layers)
+		pixels = realloc(scr->pixels, width * height * sizeof(Uint32));
+	if(!layers || !pixels) {
+		free(layers);
 		return;
 	}
-	free(uxn_screen.bg);
-	free(uxn_screen.fg);
-	uxn_screen.bg = bg;
-	uxn_screen.fg = fg;
-	uxn_screen.pixels = pixels;
-	uxn_screen.width = width;
-	uxn_screen.height = height;
-	screen_fill(uxn_screen.bg, 0, 0, width, height, 0);
-	screen_fill(uxn_screen.fg, 0, 0, width, height, 0);
-	emu_resize(width, height);
+	free(scr->layers);
+	scr->layers = layers;
+	scr->pixels = pixels;
+	scr->width = width;
+	scr->height = height;
+	screen_change(scr, 0, 0, width, height);
+	emu_resize(scr, width, height);
+}
+
+/* The layers are composed into pixels by looking up their nibbles in the 16
+colors of the palette. With SIMD, the nibbles are spread to a byte each, the
+four bytes of the colors make four tables of 16 bytes, and a byte shuffle
+looks up 16 pixels at once in each. The composer is picked at run time, the
+best one the machine has. */
+
+typedef void (*Compose)(UxnScreen *scr, Uint32 *palette, Uint32 *dst, int pitch, int x1, int y1, int x2, int y2);
+
+static void
+compose_scalar(UxnScreen *scr, Uint32 *palette, Uint32 *dst, int pitch, int x1, int y1, int x2, int y2)
+{
+	int i, x, y, w = scr->width;
+	for(y = y1; y < y2; y++, dst += pitch)
+		for(x = x1, i = x + y * w; x < x2; x++, i++)
+			dst[x - x1] = palette[NIBBLE(scr->layers, i)];
+}
+
+static void
+compose_planes(Uint32 *palette, Uint8 planes[4][16])
+{
+	int i, j;
+	for(i = 0; i < 4; i++)
+		for(j = 0; j < 16; j++)
+			planes[i][j] = palette[j] >> (i * 8);
+}
+
+#ifdef SCREEN_X86
+
+/* a nibble from each byte in the low byte of its 16 bits, the other in the high */
+
+__attribute__((target("ssse3"))) static inline __m128i
+spread_ssse3(__m128i b)
+{
+	return _mm_or_si128(_mm_and_si128(b, _mm_set1_epi16(0x000f)), _mm_and_si128(_mm_slli_epi16(b, 4), _mm_set1_epi16(0x0f00)));
+}
+
+__attribute__((target("ssse3"))) static inline void
+compose16_ssse3(Uint32 *dst, Uint8 *src, __m128i *planes)
+{
+	__m128i c = spread_ssse3(_mm_unpacklo_epi8(_mm_loadl_epi64((__m128i *)src), _mm_setzero_si128()));
+	__m128i c0 = _mm_shuffle_epi8(planes[0], c), c1 = _mm_shuffle_epi8(planes[1], c);
+	__m128i c2 = _mm_shuffle_epi8(planes[2], c), c3 = _mm_shuffle_epi8(planes[3], c);
+	__m128i lo01 = _mm_unpacklo_epi8(c0, c1), hi01 = _mm_unpackhi_epi8(c0, c1);
+	__m128i lo23 = _mm_unpacklo_epi8(c2, c3), hi23 = _mm_unpackhi_epi8(c2, c3);
+	_mm_storeu_si128((__m128i *)dst, _mm_unpacklo_epi16(lo01, lo23));
+	_mm_storeu_si128((__m128i *)dst + 1, _mm_unpackhi_epi16(lo01, lo23));
+	_mm_storeu_si128((__m128i *)dst + 2, _mm_unpacklo_epi16(hi01, hi23));
+	_mm_storeu_si128((__m128i *)dst + 3, _mm_unpackhi_epi16(hi01, hi23));
+}
+
+__attribute__((target("ssse3"))) static void
+compose_ssse3(UxnScreen *scr, Uint32 *palette, Uint32 *dst, int pitch, int x1, int y1, int x2, int y2)
+{
+	Uint8 planes[4][16];
+	__m128i p[4];
+	int i, x, y, w = scr->width;
+	compose_planes(palette, planes);
+	for(i = 0; i < 4; i++)
+		p[i] = _mm_loadu_si128((__m128i *)planes[i]);
+	for(y = y1; y < y2; y++) {
+		Uint32 *out = dst + (y - y1) * pitch;
+		for(x = x1, i = x + y * w; x < x2 && (i & 1); x++, i++)
+			out[x - x1] = palette[NIBBLE(scr->layers, i)];
+		for(; x + 16 <= x2; x += 16, i += 16)
+			compose16_ssse3(out + x - x1, scr->layers + i / 2, p);
+		for(; x < x2; x++, i++)
+			out[x - x1] = palette[NIBBLE(scr->layers, i)];
+	}
+}
+
+/* the same on 32 pixels in two lanes of 16, with the pixels dealt to the lanes
+four at a time so that the unpacking leaves them in order */
+
+__attribute__((target("avx2"))) static void
+compose_avx2(UxnScreen *scr, Uint32 *palette, Uint32 *dst, int pitch, int x1, int y1, int x2, int y2)
+{
+	Uint8 planes[4][16];
+	__m128i q[4];
+	__m256i p[4], deal = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+	int i, x, y, w = scr->width;
+	compose_planes(palette, planes);
+	for(i = 0; i < 4; i++) {
+		q[i] = _mm_loadu_si128((__m128i *)planes[i]);
+		p[i] = _mm256_broadcastsi128_si256(q[i]);
+	}
+	for(y = y1; y < y2; y++) {
+		Uint32 *out = dst + (y - y1) * pitch;
+		for(x = x1, i = x + y * w; x < x2 && (i & 1); x++, i++)
+			out[x - x1] = palette[NIBBLE(scr->layers, i)];
+		for(; x + 32 <= x2; x += 32, i += 32) {
+			__m256i b = _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i *)(scr->layers + i / 2)));
+			__m256i c = _mm256_or_si256(_mm256_and_si256(b, _mm256_set1_epi16(0x000f)), _mm256_and_si256(_mm256_slli_epi16(b, 4), _mm256_set1_epi16(0x0f00)));
+			__m256i c0, c1, c2, c3, lo01, hi01, lo23, hi23;
+			__m256i *to = (__m256i *)(out + x - x1);
+			c = _mm256_permutevar8x32_epi32(c, deal);
+			c0 = _mm256_shuffle_epi8(p[0], c), c1 = _mm256_shuffle_epi8(p[1], c);
+			c2 = _mm256_shuffle_epi8(p[2], c), c3 = _mm256_shuffle_epi8(p[3], c);
+			lo01 = _mm256_unpacklo_epi8(c0, c1), hi01 = _mm256_unpackhi_epi8(c0, c1);
+			lo23 = _mm256_unpacklo_epi8(c2, c3), hi23 = _mm256_unpackhi_epi8(c2, c3);
+			_mm256_storeu_si256(to, _mm256_unpacklo_epi16(lo01, lo23));
+			_mm256_storeu_si256(to + 1, _mm256_unpackhi_epi16(lo01, lo23));
+			_mm256_storeu_si256(to + 2, _mm256_unpacklo_epi16(hi01, hi23));
+			_mm256_storeu_si256(to + 3, _mm256_unpackhi_epi16(hi01, hi23));
+		}
+		if(x + 16 <= x2) {
+			compose16_ssse3(out + x - x1, scr->layers + i / 2, q);
+			x += 16, i += 16;
+		}
+		for(; x < x2; x++, i++)
+			out[x - x1] = palette[NIBBLE(scr->layers, i)];
+	}
+}
+
+static int
+have_ssse3(void)
+{
+	return __builtin_cpu_supports("ssse3");
+}
+
+static int
+have_avx2(void)
+{
+	return __builtin_cpu_supports("avx2");
+}
+
+#endif
+
+#ifdef __aarch64__
+
+static void
+compose_neon(UxnScreen *scr, Uint32 *palette, Uint32 *dst, int pitch, int x1, int y1, int x2, int y2)
+{
+	Uint8 planes[4][16];
+	uint8x16_t p[4], c;
+	uint8x8_t b;
+	uint8x8x2_t z;
+	uint8x16x4_t v;
+	int i, x, y, w = scr->width;
+	compose_planes(palette, planes);
+	for(i = 0; i < 4; i++)
+		p[i] = vld1q_u8(planes[i]);
+	for(y = y1; y < y2; y++) {
+		Uint32 *out = dst + (y - y1) * pitch;
+		for(x = x1, i = x + y * w; x < x2 && (i & 1); x++, i++)
+			out[x - x1] = palette[NIBBLE(scr->layers, i)];
+		for(; x + 16 <= x2; x += 16, i += 16) {
+			b = vld1_u8(scr->layers + i / 2);
+			z = vzip_u8(vand_u8(b, vdup_n_u8(0xf)), vshr_n_u8(b, 4));
+			c = vcombine_u8(z.val[0], z.val[1]);
+			v.val[0] = vqtbl1q_u8(p[0], c);
+			v.val[1] = vqtbl1q_u8(p[1], c);
+			v.val[2] = vqtbl1q_u8(p[2], c);
+			v.val[3] = vqtbl1q_u8(p[3], c);
+			vst4q_u8((uint8_t *)(out + x - x1), v);
+		}
+		for(; x < x2; x++, i++)
+			out[x - x1] = palette[NIBBLE(scr->layers, i)];
+	}
+}
+
+#endif
+
+/* best first, the last one runs anywhere */
+
+static struct {
+	char *name;
+	int (*usable)(void);
+	Compose compose;
+} composers[] = {
+#ifdef SCREEN_X86
+	{"avx2", have_avx2, compose_avx2},
+	{"ssse3", have_ssse3, compose_ssse3},
+#endif
+#ifdef __aarch64__
+	{"neon", NULL, compose_neon},
+#endif
+	{"scalar", NULL, compose_scalar}};
+
+static int composer = -1; /* set by screen_composer, the best one otherwise */
+
+static Compose
+screen_compose(void)
+{
+	int i = composer;
+	if(i < 0)
+		for(i = 0; composers[i].usable && !composers[i].usable(); i++)
+			;
+	return composers[i].compose;
 }
 
+char *
+screen_composer(int n)
+{
+	int i;
+	for(i = 0; i < (int)(sizeof(composers) / sizeof(*composers)); i++)
+		if((!composers[i].usable || composers[i].usable()) && !n--) {
+			composer = i;
+			return composers[i].name;
+		}
+	return NULL;
+}
+
+/* Redraws the runs of changed tiles along each row of them. Each run is drawn
+where emu_lock says, which is scr->pixels unless the frontend has a buffer of
+its own, and handed to emu_update for the frontend to show. */
+
 void
-screen_redraw(void)
-{
-	Uint8 *fg = uxn_screen.fg, *bg = uxn_screen.bg;
-	Uint32 palette[16], *pixels = uxn_screen.pixels;
-	int i, x, y, w = uxn_screen.width, h = uxn_screen.height;
-	int x1 = uxn_screen.x1;
-	int y1 = uxn_screen.y1;
-	int x2 = uxn_screen.x2 > w ? w : uxn_screen.x2;
-	int y2 = uxn_screen.y2 > h ? h : uxn_screen.y2;
+screen_redraw(UxnScreen *scr)
+{
+	Compose compose = screen_compose();
+	Uint8 *row;
+	Uint32 palette[16], *dst;
+	int i, pitch, x1, y1, x2, y2, w = scr->width, h = scr->height;
+	int tx, ty, cols = (w + SCREEN_TILE - 1) / SCREEN_TILE, rows = (h + SCREEN_TILE - 1) / SCREEN_TILE;
+	if(!scr->changed)
+		return;
 	for(i = 0; i < 16; i++)
-		palette[i] = uxn_screen.palette[(i >> 2) ? (i >> 2) : (i & 3)];
-	for(y = y1; y < y2; y++)
-		for(x = x1; x < x2; x++) {
-			i = x + y * w;
-			pixels[i] = palette[fg[i] << 2 | bg[i]];
+		palette[i] = scr->palette[(i >> 2) ? (i >> 2) : (i & 3)];
+	for(ty = 0; ty < rows; ty++) {
+		row = scr->tiles + ty * SCREEN_TILES;
+		for(tx = 0; tx < cols; tx++) {
+			if(!row[tx])
+				continue;
+			for(x1 = tx; tx < cols && row[tx]; tx++)
+				row[tx] = 0;
+			x1 *= SCREEN_TILE, x2 = tx * SCREEN_TILE;
+			y1 = ty * SCREEN_TILE, y2 = y1 + SCREEN_TILE;
+			if(x2 > w) x2 = w;
+			if(y2 > h) y2 = h;
+			if(!(dst = emu_lock(scr, x1, y1, x2 - x1, y2 - y1, &pitch))) {
+				dst = scr->pixels + x1 + y1 * w;
+				pitch = w;
+			}
+			compose(scr, palette, dst, pitch, x1, y1, x2, y2);
+			emu_update(scr, x1, y1, x2 - x1, y2 - y1);
 		}
-	uxn_screen.x1 = uxn_screen.y1 = uxn_screen.x2 = uxn_screen.y2 = 0;
+	}
+	scr->changed = 0;
 }
 
 /* clang-format off */
@@ -144,69 +455,69 @@ Uint8 icons[] = {
 
 /* clang-format on */
 
-void
-draw_byte(Uint8 v, Uint16 x, Uint16 y, Uint8 color)
+static void
+draw_byte(UxnScreen *scr, Uint8 v, Uint16 x, Uint16 y, Uint8 color)
 {
-	screen_blit(uxn_screen.fg, icons, v >> 4 << 3, x, y, color, 0, 0, 0);
-	screen_blit(uxn_screen.fg, icons, (v & 0xf) << 3, x + 8, y, color, 0, 0, 0);
+	screen_blit(scr, FG, icons, v >> 4 << 3, x, y, color, 0, 0, 0);
+	screen_blit(scr, FG, icons, (v & 0xf) << 3, x + 8, y, color, 0, 0, 0);
 }
 
 void
-screen_debugger(Uxn *u)
+screen_debugger(UxnScreen *scr, Uxn *u)
 {
 	int i;
 	for(i = 0; i < u->wst.ptr; i++)
-		draw_byte(u->wst.dat[i], i * 0x18 + 0x8, uxn_screen.height - 0x18, 0x2);
+		draw_byte(scr, u->wst.dat[i], i * 0x18 + 0x8, scr->height - 0x18, 0x2);
 	for(i = 0; i < u->rst.ptr; i++)
-		draw_byte(u->rst.dat[i], i * 0x18 + 0x8, uxn_screen.height - 0x10, 0x3);
+		draw_byte(scr, u->rst.dat[i], i * 0x18 + 0x8, scr->height - 0x10, 0x3);
 	for(i = 0; i < 0x40; i++)
-		draw_byte(u->ram[i], (i & 0x7) * 0x18 + 0x8, ((i >> 3) << 3) + 0x8, 1 + !!u->ram[i]);
+		draw_byte(scr, u->ram[i], (i & 0x7) * 0x18 + 0x8, ((i >> 3) << 3) + 0x8, 1 + !!u->ram[i]);
 }
 
 Uint8
-screen_dei(Uxn *u, Uint8 addr)
+screen_dei(UxnScreen *scr, Uxn *u, Uint8 addr)
 {
 	switch(addr) {
-	case 0x22: return uxn_screen.width >> 8;
-	case 0x23: return uxn_screen.width;
-	case 0x24: return uxn_screen.height >> 8;
-	case 0x25: return uxn_screen.height;
+	case 0x22: return scr->width >> 8;
+	case 0x23: return scr->width;
+	case 0x24: return scr->height >> 8;
+	case 0x25: return scr->height;
 	default: return u->dev[addr];
 	}
 }
 
 void
-screen_deo(Uint8 *ram, Uint8 *d, Uint8 port)
+screen_deo(UxnScreen *scr, Uint8 *ram, Uint8 *d, Uint8 port)
 {
 	switch(port) {
 	case 0x3:
-		screen_resize(PEEK2(d + 2), uxn_screen.height);
+		screen_resize(scr, PEEK2(d + 2), scr->height);
 		break;
 	case 0x5:
-		screen_resize(uxn_screen.width, PEEK2(d + 4));
+		screen_resize(scr, scr->width, PEEK2(d + 4));
 		break;
 	case 0xe: {
 		Uint8 ctrl = d[0xe];
 		Uint8 color = ctrl & 0x3;
 		Uint16 x = PEEK2(d + 0x8);
 		Uint16 y = PEEK2(d + 0xa);
-		Uint8 *layer = (ctrl & 0x40) ? uxn_screen.fg : uxn_screen.bg;
+		int layer = (ctrl & 0x40) ? FG : BG;
 		/* fill mode */
 		if(ctrl & 0x80) {
-			Uint16 x2 = uxn_screen.width;
-			Uint16 y2 = uxn_screen.height;
+			Uint16 x2 = scr->width;
+			Uint16 y2 = scr->height;
 			if(ctrl & 0x10) x2 = x, x = 0;
 			if(ctrl & 0x20) y2 = y, y = 0;
-			screen_fill(layer, x, y, x2, y2, color);
-			screen_change(x, y, x2, y2);
+			screen_fill(scr, layer, x, y, x2, y2, color);
+			screen_change(scr, x, y, x2, y2);
 		}
 		/* pixel mode */
 		else {
-			Uint16 width = uxn_screen.width;
-			Uint16 height = uxn_screen.height;
+			Uint16 width = scr->width;
+			Uint16 height = scr->height;
 			if(x < width && y < height)
-				layer[x + y * width] = color;
-			screen_change(x, y, x + 1, y + 1);
+				layer_put(scr->layers, x + y * width, layer, color);
+			screen_change(scr, x, y, x + 1, y + 1);
 			if(d[0x6] & 0x1) POKE2(d + 0x8, x + 1); /* auto x+1 */
 			if(d[0x6] & 0x2) POKE2(d + 0xa, y + 1); /* auto y+1 */
 		}
@@ -218,7 +529,7 @@ screen_deo(Uint8 *ram, Uint8 *d, Uint8 port)
 		Uint8 move = d[0x6];
 		Uint8 length = move >> 4;
 		Uint8 twobpp = !!(ctrl & 0x80);
-		Uint8 *layer = (ctrl & 0x40) ? uxn_screen.fg : uxn_screen.bg;
+		int layer = (ctrl & 0x40) ? FG : BG;
 		Uint8 color = ctrl & 0xf;
 		Uint16 x = PEEK2(d + 0x8), dx = (move & 0x1) << 3;
 		Uint16 y = PEEK2(d + 0xa), dy = (move & 0x2) << 2;
@@ -227,10 +538,11 @@ screen_deo(Uint8 *ram, Uint8 *d, Uint8 port)
 		int flipy = (ctrl & 0x20), fy = flipy ? -1 : 1;
 		Uint16 dyx = dy * fx, dxy = dx * fy;
 		for(i = 0; i <= length; i++) {
-			screen_blit(layer, ram, addr, x + dyx * i, y + dxy * i, color, flipx, flipy, twobpp);
+			Uint16 sx = x + dyx * i, sy = y + dxy * i;
+			screen_blit(scr, layer, ram, addr, sx, sy, color, flipx, flipy, twobpp);
+			screen_change(scr, sx, sy, sx + 8, sy + 8);
 			addr += addr_incr;
 		}
-		screen_change(x, y, x + dyx * length + 8, y + dxy * length + 8);
 		if(move & 0x1) POKE2(d + 0x8, x + dx * fx); /* auto x+8 */
 		if(move & 0x2) POKE2(d + 0xa, y + dy * fy); /* auto y+8 */
 		if(move & 0x4) POKE2(d + 0xc, addr);        /* auto addr+length */
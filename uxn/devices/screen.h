@@ -13,19 +13,25 @@ WITH REGARD TO THIS SOFTWARE.
 #define SCREEN_DEIMASK 0x003c
 #define SCREEN_DEOMASK 0xc028
 
+#define SCREEN_TILE 0x10 /* the screen is redrawn by tiles of 16x16 pixels */
+#define SCREEN_TILES (0x400 / SCREEN_TILE)
+
 typedef struct UxnScreen {
-	int width, height, x1, y1, x2, y2;
+	int width, height, changed;
 	Uint32 palette[4], *pixels;
-	Uint8 *fg, *bg;
+	Uint8 *layers; /* a nibble for each pixel, fg << 2 | bg, see screen.c */
+	Uint8 tiles[SCREEN_TILES * SCREEN_TILES]; /* the tiles changed since the last redraw, by rows */
 } UxnScreen;
 
-extern UxnScreen uxn_screen;
-extern int emu_resize(int width, int height);
+extern int emu_resize(UxnScreen *scr, int width, int height);
+extern Uint32 *emu_lock(UxnScreen *scr, int x, int y, int width, int height, int *pitch);
+extern void emu_update(UxnScreen *scr, int x, int y, int width, int height);
 
-void screen_palette(Uint8 *addr);
-void screen_resize(Uint16 width, Uint16 height);
-void screen_change(Uint16 x1, Uint16 y1, Uint16 x2, Uint16 y2);
-void screen_redraw(void);
-void screen_debugger(Uxn *u);
-Uint8 screen_dei(Uxn *u, Uint8 addr);
-void screen_deo(Uint8 *ram, Uint8 *d, Uint8 port);
+void screen_palette(UxnScreen *scr, Uint8 *addr);
+void screen_resize(UxnScreen *scr, Uint16 width, Uint16 height);
+void screen_change(UxnScreen *scr, Uint16 x1, Uint16 y1, Uint16 x2, Uint16 y2);
+void screen_redraw(UxnScreen *scr);
+char *screen_composer(int n); /* picks the nth composer the machine has, for benchmarks */
+void screen_debugger(UxnScreen *scr, Uxn *u);
+Uint8 screen_dei(UxnScreen *scr, Uxn *u, Uint8 addr);
+void screen_deo(UxnScreen *scr, Uint8 *ram, Uint8 *d, Uint8 port);
@@ -1,8 +1,16 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
 
 #include "../uxn.h"
 #include "system.h"
+#include "screen.h"
+#include "audio.h"
+#include "file.h"
+#include "../varvara.h"
 
 /*
 Copyright (c) 2022-2023 Devine Lu Linvega, Andrew Alderwick
@@ -21,28 +29,95 @@ static const char *errors[] = {
 	"division by zero"};
 
 static void
-system_print(Stack *s, char *name)
+system_print(FILE *f, Stack *s, char *name)
 {
 	Uint8 i;
-	fprintf(stderr, "<%s>", name);
+	fprintf(f, "<%s>", name);
 	for(i = 0; i < s->ptr; i++)
-		fprintf(stderr, " %02x", s->dat[i]);
+		fprintf(f, " %02x", s->dat[i]);
 	if(!i)
-		fprintf(stderr, " empty");
-	fprintf(stderr, "\n");
+		fprintf(f, " empty");
+	fprintf(f, "\n");
+}
+
+/* The expansion commands go over the bytes in order, wrapping around in their
+page. They run as a few memset and memmove, split where the source or the
+destination wraps. A copy onto itself that writes ahead of where it reads,
+in the direction it goes, repeats the bytes it already wrote, the way a copy
+byte by byte would. */
+
+static void
+system_copy_left(Uint8 *dst, Uint8 *src, Uint32 n)
+{
+	Uint32 k, c;
+	if(dst <= src || dst >= src + n) {
+		memmove(dst, src, n);
+		return;
+	}
+	k = dst - src;
+	memcpy(dst, src, k);
+	for(; k < n; k += c)
+		memcpy(dst + k, dst, c = k < n - k ? k : n - k);
+}
+
+static void
+system_copy_right(Uint8 *dst, Uint8 *src, Uint32 n)
+{
+	Uint32 k, c;
+	if(dst >= src || dst + n <= src) {
+		memmove(dst, src, n);
+		return;
+	}
+	k = src - dst;
+	memcpy(dst + n - k, src + n - k, k);
+	for(; k < n; k += c) {
+		c = k < n - k ? k : n - k;
+		memcpy(dst + n - k - c, dst + n - c, c);
+	}
+}
+
+static Uint32
+system_span(Uint32 n, Uint32 a, Uint32 b)
+{
+	if(n > a) n = a;
+	if(n > b) n = b;
+	return n;
 }
 
 static void
-system_cmd(Uint8 *ram, Uint16 addr)
+system_cmd(Uxn *u, Uint16 addr)
 {
-	if(ram[addr] == 0x1) {
-		Uint16 i, length = PEEK2(ram + addr + 1);
-		Uint16 a_page = PEEK2(ram + addr + 1 + 2), a_addr = PEEK2(ram + addr + 1 + 4);
-		Uint16 b_page = PEEK2(ram + addr + 1 + 6), b_addr = PEEK2(ram + addr + 1 + 8);
-		int src = (a_page % RAM_PAGES) * 0x10000, dst = (b_page % RAM_PAGES) * 0x10000;
-		for(i = 0; i < length; i++)
-			ram[dst + (Uint16)(b_addr + i)] = ram[src + (Uint16)(a_addr + i)];
+	Uint8 *ram = u->ram, op = ram[addr];
+	Uint32 i, n, length = PEEK2(ram + addr + 1);
+	Uint16 a_page = PEEK2(ram + addr + 1 + 2), a_addr = PEEK2(ram + addr + 1 + 4);
+	Uint16 b_page = PEEK2(ram + addr + 1 + 6), b_addr = PEEK2(ram + addr + 1 + 8);
+	Uint8 *src = ram + (a_page % RAM_PAGES) * 0x10000, *dst = ram + (b_page % RAM_PAGES) * 0x10000;
+	switch(op) {
+	case 0x0: /* fill, a is the destination */
+		for(i = 0; i < length; i += n) {
+			n = system_span(length - i, 0x10000 - (Uint16)(a_addr + i), 0x10000);
+			memset(src + (Uint16)(a_addr + i), ram[addr + 7], n);
+		}
+		if(src == ram)
+			uxn_invalidate(u, a_addr, length);
+		return;
+	case 0x1: /* copy, first byte first */
+		for(i = 0; i < length; i += n) {
+			n = system_span(length - i, 0x10000 - (Uint16)(a_addr + i), 0x10000 - (Uint16)(b_addr + i));
+			system_copy_left(dst + (Uint16)(b_addr + i), src + (Uint16)(a_addr + i), n);
+		}
+		break;
+	case 0x2: /* copy, last byte first */
+		for(i = length; i > 0; i -= n) {
+			n = system_span(i, (Uint16)(a_addr + i - 1) + 1, (Uint16)(b_addr + i - 1) + 1);
+			system_copy_right(dst + (Uint16)(b_addr + i - n), src + (Uint16)(a_addr + i - n), n);
+		}
+		break;
+	default:
+		return;
 	}
+	if(dst == ram)
+		uxn_invalidate(u, b_addr, length);
 }
 
 int
@@ -53,6 +128,43 @@ system_error(char *msg, const char *err)
 	return 0;
 }
 
+/* All the pages are reserved up front and only committed as they get written,
+until then they read as the shared zero page. Most roms never leave page 0.
+Clearing maps fresh pages over the old ones rather than writing zeroes, only
+Linux promises that pages given back with madvise read as zeroes again. */
+
+Uint8 *
+system_ram(void)
+{
+#ifdef _WIN32
+	return calloc(0x10000 * RAM_PAGES, sizeof(Uint8));
+#else
+	void *ram = mmap(NULL, 0x10000 * RAM_PAGES, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	return ram == MAP_FAILED ? NULL : ram;
+#endif
+}
+
+void
+system_ram_clear(Uint8 *ram)
+{
+#ifndef _WIN32
+	if(mmap(ram, 0x10000 * RAM_PAGES, PROT_READ | PROT_WRITE, MAP_FIXED | MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0) == ram)
+		return;
+#endif
+	memset(ram, 0, 0x10000 * RAM_PAGES);
+}
+
+void
+system_ram_free(Uint8 *ram)
+{
+#ifdef _WIN32
+	free(ram);
+#else
+	if(ram)
+		munmap(ram, 0x10000 * RAM_PAGES);
+#endif
+}
+
 int
 system_load(Uxn *u, char *filename)
 {
@@ -64,33 +176,35 @@ system_load(Uxn *u, char *filename)
 	while(l && ++i < RAM_PAGES)
 		l = fread(u->ram + 0x10000 * i, 0x10000, 1, f);
 	fclose(f);
+	uxn_invalidate(u, 0, 0x10000);
 	return 1;
 }
 
 void
 system_inspect(Uxn *u)
 {
-	system_print(&u->wst, "wst");
-	system_print(&u->rst, "rst");
+	system_print(u->emu->err, &u->wst, "wst");
+	system_print(u->emu->err, &u->rst, "rst");
+	fflush(u->emu->err);
 }
 
 void
-system_connect(Uint8 device, Uint8 ver, Uint16 dei, Uint16 deo)
+system_connect(Uxn *u, Uint8 device, Uint8 ver, Uint16 dei, Uint16 deo)
 {
-	dev_vers[device] = ver;
-	dei_mask[device] = dei;
-	deo_mask[device] = deo;
+	u->dev_vers[device] = ver;
+	u->dei_mask[device] = dei;
+	u->deo_mask[device] = deo;
 }
 
 int
-system_version(char *name, char *date)
+system_version(Uxn *u, char *name, char *date)
 {
 	int i;
 	printf("%s, %s.\n", name, date);
 	printf("Device Version Dei  Deo\n");
 	for(i = 0; i < 0x10; i++)
-		if(dev_vers[i])
-			printf("%6x %7d %04x %04x\n", i, dev_vers[i], dei_mask[i], deo_mask[i]);
+		if(u->dev_vers[i])
+			printf("%6x %7d %04x %04x\n", i, u->dev_vers[i], u->dei_mask[i], u->deo_mask[i]);
 	return 0;
 }
 
@@ -101,13 +215,20 @@ system_deo(Uxn *u, Uint8 *d, Uint8 port)
 {
 	switch(port) {
 	case 0x3:
-		system_cmd(u->ram, PEEK2(d + 2));
+		system_cmd(u, PEEK2(d + 2));
 		break;
 	case 0x5:
 		if(PEEK2(d + 4)) {
 			Uxn friend;
 			uxn_boot(&friend, u->ram);
+			/* the same devices, and the same blocks for the same ram */
+			memcpy(friend.dev_vers, u->dev_vers, sizeof(u->dev_vers));
+			memcpy(friend.dei_mask, u->dei_mask, sizeof(u->dei_mask));
+			memcpy(friend.deo_mask, u->deo_mask, sizeof(u->deo_mask));
+			friend.emu = u->emu;
+			friend.cache = u->cache;
 			uxn_eval(&friend, PEEK2(d + 4));
+			u->cache = friend.cache;
 		}
 		break;
 	case 0xe:
@@ -132,7 +253,8 @@ emu_halt(Uxn *u, Uint8 instr, Uint8 err, Uint16 addr)
 		return uxn_eval(u, handler);
 	} else {
 		system_inspect(u);
-		fprintf(stderr, "%s %s, by %02x at 0x%04x.\n", (instr & 0x40) ? "Return-stack" : "Working-stack", errors[err - 1], instr, addr);
+		fprintf(u->emu->err, "%s %s, by %02x at 0x%04x.\n", (instr & 0x40) ? "Return-stack" : "Working-stack", errors[err - 1], instr, addr);
+		fflush(u->emu->err);
 	}
 	return 0;
 }
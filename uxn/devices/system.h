@@ -15,8 +15,11 @@ WITH REGARD TO THIS SOFTWARE.
 
 #define RAM_PAGES 0x10
 
-void system_connect(Uint8 device, Uint8 ver, Uint16 dei, Uint16 deo);
-int system_version(char *emulator, char *date);
+void system_connect(Uxn *u, Uint8 device, Uint8 ver, Uint16 dei, Uint16 deo);
+int system_version(Uxn *u, char *emulator, char *date);
+Uint8 *system_ram(void);
+void system_ram_clear(Uint8 *ram);
+void system_ram_free(Uint8 *ram);
 int system_load(Uxn *u, char *filename);
 void system_inspect(Uxn *u);
 int system_error(char *msg, const char *err);
@@ -0,0 +1,223 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "uxn.h"
+#include "profile.h"
+
+/* Counts every instruction uxn_eval runs, by address, by the vector it ran
+under, and by the call stack it ran in. Calls are JSR and JSI, a call
+returns when the caller's next instruction runs, so a JMP2r anywhere in the
+callee returns and a tail call stays in its caller. Labels are read from the
+.sym file uxnasm writes next to the rom, when there is one. */
+
+#define NODES 0x10000
+#define DEPTH 0x80
+#define ROOT 0xffffff00
+#define TOP 16
+
+typedef unsigned long long Count;
+
+typedef struct {
+	Uint32 parent;
+	Uint16 addr;
+	Count hits;
+} Node;
+
+static const struct {
+	char *name;
+	Uint8 port;
+} vectors[] = {
+	{"reset", 0x00},
+	{"console", 0x10},
+	{"screen", 0x20},
+	{"audio", 0x30},
+	{"audio", 0x40},
+	{"audio", 0x50},
+	{"audio", 0x60},
+	{"controller", 0x80},
+	{"mouse", 0x90},
+	{"other", 0x00}};
+
+#define VECTORS (sizeof(vectors) / sizeof(vectors[0]))
+
+static struct {
+	Count hits[0x10000], calls[VECTORS], steps[VECTORS];
+	Node node[NODES];
+	Uint32 nodes, table[NODES * 2];
+	struct {
+		Uint32 node;
+		Uint16 ret;
+	} frame[DEPTH];
+	int depth, vector;
+	char *labels, *label[0x10000];
+} prof;
+
+static Uint32
+profile_node(Uint32 parent, Uint16 addr)
+{
+	Uint32 i = (parent * 0x9e3779b1u ^ addr) & (NODES * 2 - 1);
+	Node *n;
+	for(;; i = (i + 1) & (NODES * 2 - 1)) {
+		if(!prof.table[i])
+			break;
+		n = &prof.node[prof.table[i] - 1];
+		if(n->parent == parent && n->addr == addr)
+			return prof.table[i] - 1;
+	}
+	/* out of nodes, the rest of the stack goes to the caller */
+	if(prof.nodes == NODES)
+		return parent < ROOT ? parent : 0;
+	n = &prof.node[prof.nodes];
+	n->parent = parent;
+	n->addr = addr;
+	prof.table[i] = ++prof.nodes;
+	return prof.nodes - 1;
+}
+
+int
+profile_load(char *rom)
+{
+	char path[0x400];
+	FILE *f;
+	long len, i;
+	int n = strlen(rom);
+	if(n > 4 && !strcmp(rom + n - 4, ".rom"))
+		n -= 4;
+	snprintf(path, sizeof(path), "%.*s.sym", n, rom);
+	if(!(f = fopen(path, "rb"))) {
+		snprintf(path, sizeof(path), "%s.sym", rom);
+		if(!(f = fopen(path, "rb")))
+			return 0;
+	}
+	fseek(f, 0, SEEK_END);
+	len = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	free(prof.labels);
+	memset(prof.label, 0, sizeof(prof.label));
+	if(len < 0 || !(prof.labels = malloc(len + 1)) || fread(prof.labels, 1, len, f) != (size_t)len) {
+		fclose(f);
+		return 0;
+	}
+	fclose(f);
+	prof.labels[len] = 0;
+	/* each label is its address, big endian, and its name ended by a zero */
+	for(i = 0; i + 2 < len; i += strlen(prof.labels + i) + 1) {
+		Uint16 addr = PEEK2((Uint8 *)prof.labels + i);
+		i += 2;
+		if(!prof.label[addr])
+			prof.label[addr] = prof.labels + i;
+	}
+	return 1;
+}
+
+void
+profile_vector(Uxn *u, Uint16 pc)
+{
+	int v = VECTORS - 1;
+	Uint32 i;
+	if(pc == PAGE_PROGRAM)
+		v = 0;
+	else
+		for(i = 1; i < VECTORS - 1; i++)
+			if(PEEK2(&u->dev[vectors[i].port]) == pc) {
+				v = i;
+				break;
+			}
+	prof.vector = v;
+	prof.calls[v]++;
+	prof.depth = 0;
+	prof.frame[0].node = profile_node(ROOT | v, pc);
+}
+
+void
+profile_step(Uxn *u, Uint16 pc, Uint8 ins)
+{
+	Stack *s = ins & 0x40 ? &u->rst : &u->wst;
+	Uint16 callee;
+	if(prof.depth && pc == prof.frame[prof.depth].ret)
+		prof.depth--;
+	prof.hits[pc]++;
+	prof.steps[prof.vector]++;
+	prof.node[prof.frame[prof.depth].node].hits++;
+	if(ins == 0x60) /* JSI */
+		callee = pc + 3 + PEEK2(u->ram + (Uint16)(pc + 1));
+	else if((ins & 0x3f) == 0x2e && s->ptr >= 2) /* JSR2 */
+		callee = PEEK2(&s->dat[s->ptr - 2]);
+	else if((ins & 0x3f) == 0x0e && s->ptr >= 1) /* JSR */
+		callee = pc + 1 + (Sint8)s->dat[s->ptr - 1];
+	else
+		return;
+	if(prof.depth == DEPTH - 1)
+		return;
+	prof.frame[prof.depth + 1].node = profile_node(prof.frame[prof.depth].node, callee);
+	prof.frame[prof.depth + 1].ret = pc + (ins == 0x60 ? 3 : 1);
+	prof.depth++;
+}
+
+static char *
+profile_name(Uint16 addr, char *buf, int len)
+{
+	Uint32 i = addr;
+	if(prof.label[addr])
+		return prof.label[addr];
+	while(prof.labels && i > 0 && !prof.label[i])
+		i--;
+	if(prof.label[i])
+		snprintf(buf, len, "%s+%x", prof.label[i], addr - i);
+	else
+		snprintf(buf, len, "%04x", addr);
+	return buf;
+}
+
+void
+profile_report(void)
+{
+	Uint32 i, j, top[TOP] = {0};
+	Count total = 0;
+	char buf[0x100];
+	for(i = 0; i < VECTORS; i++)
+		total += prof.steps[i];
+	if(!total)
+		return;
+	fprintf(stderr, "%-12s %10s %12s %6s\n", "vector", "calls", "instructions", "%");
+	for(i = 0; i < VECTORS; i++)
+		if(prof.calls[i])
+			fprintf(stderr, "%-12s %10llu %12llu %6.2f\n", vectors[i].name, prof.calls[i], prof.steps[i], prof.steps[i] * 100.0 / total);
+	for(i = 0; i < 0x10000; i++) {
+		if(prof.hits[i] <= prof.hits[top[TOP - 1]])
+			continue;
+		for(j = TOP - 1; j > 0 && prof.hits[i] > prof.hits[top[j - 1]]; j--)
+			top[j] = top[j - 1];
+		top[j] = i;
+	}
+	fprintf(stderr, "%-6s %-24s %12s %6s\n", "addr", "label", "hits", "%");
+	for(i = 0; i < TOP && prof.hits[top[i]]; i++)
+		fprintf(stderr, "%04x   %-24s %12llu %6.2f\n", top[i], profile_name(top[i], buf, sizeof(buf)), prof.hits[top[i]], prof.hits[top[i]] * 100.0 / total);
+}
+
+/* One line per call stack, its frames from the vector down separated by
+semicolons, then the instructions it ran: the collapsed format flamegraph.pl
+and speedscope read. */
+
+int
+profile_save(char *filename)
+{
+	Uint32 i, n, path[DEPTH + 1];
+	char buf[0x100];
+	FILE *f = fopen(filename, "w");
+	if(!f)
+		return 0;
+	for(i = 0; i < prof.nodes; i++) {
+		if(!prof.node[i].hits)
+			continue;
+		for(n = 0, path[n++] = i; prof.node[path[n - 1]].parent < ROOT && n < DEPTH + 1; n++)
+			path[n] = prof.node[path[n - 1]].parent;
+		fprintf(f, "%s", vectors[prof.node[path[n - 1]].parent - ROOT].name);
+		while(n--)
+			fprintf(f, ";%s", profile_name(prof.node[path[n]].addr, buf, sizeof(buf)));
+		fprintf(f, " %llu\n", prof.node[i].hits);
+	}
+	fclose(f);
+	return 1;
+}
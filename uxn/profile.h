@@ -0,0 +1,7 @@
+/* Instruction profiler, built in with UXN_PROFILE */
+
+int profile_load(char *rom);
+void profile_vector(Uxn *u, Uint16 pc);
+void profile_step(Uxn *u, Uint16 pc, Uint8 ins);
+void profile_report(void);
+int profile_save(char *filename);
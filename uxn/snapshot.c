@@ -0,0 +1,218 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "uxn.h"
+#include "snapshot.h"
+#include "devices/system.h"
+#include "devices/screen.h"
+#include "devices/audio.h"
+#include "devices/file.h"
+#include "varvara.h"
+
+/* A snapshot is "UXNSNAP" and a version byte, then chunks of a four letter
+tag, a big endian length and as many bytes. Memory pages left all zeroes are
+not saved, the others and the screen are run length encoded: a byte n below
+0x80 is followed by n + 1 bytes to copy, any other by one byte to repeat
+n - 0x7d times. Loaders skip the chunks they don't know. */
+
+#define SNAPSHOT_VERSION 1
+#define PACKED(n) ((n) + (n) / 0x80 + 1)
+
+static Uint32
+snapshot_pack(Uint8 *src, Uint32 len, Uint8 *dst)
+{
+	Uint32 i = 0, j, n, o = 0;
+	while(i < len) {
+		for(n = 1; i + n < len && n < 0x82 && src[i + n] == src[i]; n++)
+			;
+		if(n >= 3) {
+			dst[o++] = n + 0x7d;
+			dst[o++] = src[i];
+			i += n;
+			continue;
+		}
+		/* copy up to the next run worth repeating */
+		for(j = i + 1; j < len && j - i < 0x80; j++)
+			if(j + 2 < len && src[j] == src[j + 1] && src[j] == src[j + 2])
+				break;
+		dst[o++] = j - i - 1;
+		memcpy(dst + o, src + i, j - i);
+		o += j - i;
+		i = j;
+	}
+	return o;
+}
+
+/* with no dst, only checks that src unpacks to size bytes */
+
+static int
+snapshot_unpack(Uint8 *src, Uint32 len, Uint8 *dst, Uint32 size)
+{
+	Uint32 i = 0, o = 0, n;
+	while(i < len) {
+		Uint8 c = src[i++];
+		if(c < 0x80) {
+			n = c + 1;
+			if(i + n > len || o + n > size)
+				return 0;
+			if(dst)
+				memcpy(dst + o, src + i, n);
+			i += n;
+		} else {
+			n = c - 0x7d;
+			if(i == len || o + n > size)
+				return 0;
+			if(dst)
+				memset(dst + o, src[i], n);
+			i++;
+		}
+		o += n;
+	}
+	return o == size;
+}
+
+static void
+snapshot_chunk(FILE *f, char *tag, Uint8 *head, Uint32 headlen, Uint8 *data, Uint32 len)
+{
+	Uint8 b[4];
+	len += headlen;
+	POKE2(b, len >> 16)
+	POKE2(b + 2, len)
+	fwrite(tag, 4, 1, f);
+	fwrite(b, 4, 1, f);
+	if(headlen)
+		fwrite(head, headlen, 1, f);
+	fwrite(data, len - headlen, 1, f);
+}
+
+int
+uxn_snapshot_save(Uxn *u, char *filename)
+{
+	UxnScreen *scr = &u->emu->screen;
+	Uint32 i, j, n = scr->width * scr->height, size = PACKED(0x10000);
+	Uint8 core[0x302], head[5], *buf, *packed, state[POLYPHONY * AUDIO_SNAPSHOT];
+	FILE *f;
+	if(PACKED((n + 1) / 2) > size)
+		size = PACKED((n + 1) / 2);
+	if(!(buf = calloc(size * 2, 1)))
+		return 0;
+	if(!(f = fopen(filename, "wb"))) {
+		free(buf);
+		return 0;
+	}
+	packed = buf + size;
+	fwrite("UXNSNAP", 7, 1, f);
+	fputc(SNAPSHOT_VERSION, f);
+	/* devices, stacks and a vector that yielded */
+	memcpy(core, u->dev, 0x100);
+	memcpy(core + 0x100, &u->wst, 0x100);
+	memcpy(core + 0x200, &u->rst, 0x100);
+	POKE2(core + 0x300, u->resume)
+	snapshot_chunk(f, "core", NULL, 0, core, sizeof(core));
+	for(i = 0; i < RAM_PAGES; i++) {
+		Uint8 *page = u->ram + 0x10000 * i;
+		for(j = 0; j < 0x10000 && !page[j]; j++)
+			;
+		if(j == 0x10000)
+			continue;
+		head[0] = i;
+		snapshot_chunk(f, "page", head, 1, packed, snapshot_pack(page, 0x10000, packed));
+	}
+	/* both layers, a nibble for each pixel as the screen keeps them */
+	POKE2(head, scr->width)
+	POKE2(head + 2, scr->height)
+	snapshot_chunk(f, "scrn", head, 4, packed, snapshot_pack(scr->layers, (n + 1) / 2, packed));
+	for(i = 0; i < POLYFILEY; i++) {
+		head[0] = i;
+		snapshot_chunk(f, "file", head, 1, buf, file_save(&u->emu->file[i], buf, size));
+	}
+	if(emu_snapshot_audio(u, state, 1))
+		snapshot_chunk(f, "audo", NULL, 0, state, sizeof(state));
+	free(buf);
+	return !fclose(f);
+}
+
+/* Walks the chunks the way loading does, without loading anything: the
+lengths have to fit, and the pages and the screen have to unpack to their
+sizes. The screen, there can only be one, is left in scrn. */
+
+static int
+snapshot_check(Uint8 *p, Uint8 *end, Uint8 **scrn)
+{
+	Uint8 *chunk;
+	Uint32 n;
+	*scrn = NULL;
+	for(; p + 8 <= end; p = chunk + n) {
+		chunk = p + 8;
+		n = PEEK2(p + 4) << 16 | PEEK2(p + 6);
+		if(n > (Uint32)(end - chunk))
+			return 0;
+		if(!memcmp(p, "page", 4) && n && chunk[0] < RAM_PAGES) {
+			if(!snapshot_unpack(chunk + 1, n - 1, NULL, 0x10000))
+				return 0;
+		} else if(!memcmp(p, "scrn", 4) && n >= 4) {
+			Uint16 width = PEEK2(chunk), height = PEEK2(chunk + 2);
+			if(*scrn || width < 0x8 || height < 0x8 || width >= 0x400 || height >= 0x400)
+				return 0;
+			if(!snapshot_unpack(chunk + 4, n - 4, NULL, (width * height + 1) / 2))
+				return 0;
+			*scrn = chunk;
+		} else if(!memcmp(p, "file", 4) && n && chunk[0] < POLYFILEY && n < 7)
+			return 0;
+	}
+	return p == end;
+}
+
+int
+uxn_snapshot_load(Uxn *u, char *filename)
+{
+	UxnScreen *scr = &u->emu->screen;
+	Uint8 *data = NULL, *p, *end, *chunk, *screen;
+	Uint32 len, size = 0, n;
+	FILE *f = fopen(filename, "rb");
+	if(!f)
+		return 0;
+	for(len = 0; !feof(f) && !ferror(f); len += fread(data + len, 1, size - len, f))
+		if(len == size && !(data = realloc(p = data, size += 0x10000))) {
+			free(p);
+			fclose(f);
+			return 0;
+		}
+	fclose(f);
+	end = data + len;
+	if(len < 8 || memcmp(data, "UXNSNAP", 7) || data[7] != SNAPSHOT_VERSION || !snapshot_check(data + 8, end, &screen)) {
+		free(data);
+		return 0;
+	}
+	/* resizing the screen is all that can still fail, so it goes first */
+	if(screen) {
+		screen_resize(scr, PEEK2(screen), PEEK2(screen + 2));
+		if(scr->width != PEEK2(screen) || scr->height != PEEK2(screen + 2)) {
+			free(data);
+			return 0;
+		}
+	}
+	system_ram_clear(u->ram);
+	for(p = data + 8; p + 8 <= end; p = chunk + n) {
+		chunk = p + 8;
+		n = PEEK2(p + 4) << 16 | PEEK2(p + 6);
+		if(!memcmp(p, "core", 4) && n == 0x302) {
+			memcpy(u->dev, chunk, 0x100);
+			memcpy(&u->wst, chunk + 0x100, 0x100);
+			memcpy(&u->rst, chunk + 0x200, 0x100);
+			u->resume = PEEK2(chunk + 0x300);
+		} else if(!memcmp(p, "page", 4) && n && chunk[0] < RAM_PAGES)
+			snapshot_unpack(chunk + 1, n - 1, u->ram + 0x10000 * chunk[0], 0x10000);
+		else if(chunk == screen)
+			snapshot_unpack(chunk + 4, n - 4, scr->layers, (scr->width * scr->height + 1) / 2);
+		else if(!memcmp(p, "file", 4) && n && chunk[0] < POLYFILEY)
+			file_load(&u->emu->file[chunk[0]], chunk + 1, n - 1);
+		else if(!memcmp(p, "audo", 4) && n == POLYPHONY * AUDIO_SNAPSHOT)
+			emu_snapshot_audio(u, chunk, 0);
+	}
+	uxn_invalidate(u, 0, 0x10000);
+	screen_palette(scr, &u->dev[0x8]);
+	free(data);
+	return 1;
+}
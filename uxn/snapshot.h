@@ -0,0 +1,9 @@
+/* Snapshots of the whole machine, see snapshot.c */
+
+int uxn_snapshot_save(Uxn *u, char *filename);
+int uxn_snapshot_load(Uxn *u, char *filename);
+
+/* required functions, the audio device belongs to the frontend and plays on
+its own thread, state holds AUDIO_SNAPSHOT bytes for each channel */
+
+extern int emu_snapshot_audio(Uxn *u, Uint8 *state, int save);
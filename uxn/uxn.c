@@ -11,9 +11,22 @@ THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
 WITH REGARD TO THIS SOFTWARE.
 */
 
+/* Profiling counts each instruction as the switch interpreter steps through
+it, see profile.c */
+
+#ifdef UXN_PROFILE
+#include "profile.h"
+#undef UXN_THREADED
+#undef UXN_BLOCKS
+#else
+#define profile_vector(u, pc)
+#define profile_step(u, pc, ins)
+#endif
+
 #define HALT(c)    { return emu_halt(u, ins, (c), pc - 1); }
 #define FLIP       { s = ins & 0x40 ? &u->wst : &u->rst; }
-#define JUMP(x)    { if(m2) pc = (x); else pc += (Sint8)(x); }
+#define JUMP(x)    { from = pc; if(m2) pc = (x); else pc += (Sint8)(x); PREEMPT }
+#define PREEMPT    { if(pc < from && !--left && u->budget) { u->resume = pc; return 1; } }
 #define POKE(x, y) { if(m2) { POKE2(ram + x, y) } else { ram[(x)] = (y); } }
 #define PEEK(o, x) { if(m2) { o = PEEK2(ram + x); } else o = ram[(x)]; }
 #define PUSH1(y)   { if(s->ptr == 0xff) HALT(2) s->dat[s->ptr++] = (y); }
@@ -25,15 +38,438 @@ WITH REGARD TO THIS SOFTWARE.
 #define DEVW(p, y) { if(m2) { DEO(p, y >> 8) DEO((p + 1), y) } else { DEO(p, y) } }
 #define DEVR(o, p) { if(m2) { o = DEI(p) << 8 | DEI(p + 1); } else { o = DEI(p); } }
 
+#ifdef UXN_THREADED
+
+/* Threaded dispatch: every opcode byte gets its own handler, with the mode
+bits turned into constants, and each handler jumps straight to the next. */
+
+#define NEXT       { ins = ram[pc++]; goto *table[ins]; }
+#define OP(name, M2, R, K, body) \
+	op_##name: { \
+		enum { m2 = M2 }; \
+		Stack *s = R ? &u->rst : &u->wst; \
+		Uint8 ksp = s->ptr, *sp = K ? &ksp : &s->ptr; \
+		body \
+		NEXT \
+	}
+#define MODES(name, body) \
+	OP(name, 0, 0, 0, body) OP(name##2, 1, 0, 0, body) \
+	OP(name##r, 0, 1, 0, body) OP(name##2r, 1, 1, 0, body) \
+	OP(name##k, 0, 0, 1, body) OP(name##2k, 1, 0, 1, body) \
+	OP(name##kr, 0, 1, 1, body) OP(name##2kr, 1, 1, 1, body)
+
+/* clang-format off */
+
+#define OPCODES(X) \
+	X(INC, POPx(a) PUSHx(a + 1)) \
+	X(POP, POPx(a)) \
+	X(NIP, POPx(a) POPx(b) PUSHx(a)) \
+	X(SWP, POPx(a) POPx(b) PUSHx(a) PUSHx(b)) \
+	X(ROT, POPx(a) POPx(b) POPx(c) PUSHx(b) PUSHx(a) PUSHx(c)) \
+	X(DUP, POPx(a) PUSHx(a) PUSHx(a)) \
+	X(OVR, POPx(a) POPx(b) PUSHx(b) PUSHx(a) PUSHx(b)) \
+	X(EQU, POPx(a) POPx(b) PUSH1(b == a)) \
+	X(NEQ, POPx(a) POPx(b) PUSH1(b != a)) \
+	X(GTH, POPx(a) POPx(b) PUSH1(b > a)) \
+	X(LTH, POPx(a) POPx(b) PUSH1(b < a)) \
+	X(JMP, POPx(a) JUMP(a)) \
+	X(JCN, POPx(a) POP1(b) if(b) JUMP(a)) \
+	X(JSR, POPx(a) FLIP PUSH2(pc) JUMP(a)) \
+	X(STH, POPx(a) FLIP PUSHx(a)) \
+	X(LDZ, POP1(a) PEEK(b, a) PUSHx(b)) \
+	X(STZ, POP1(a) POPx(b) POKE(a, b)) \
+	X(LDR, POP1(a) PEEK(b, pc + (Sint8)a) PUSHx(b)) \
+	X(STR, POP1(a) POPx(b) POKE(pc + (Sint8)a, b)) \
+	X(LDA, POP2(a) PEEK(b, a) PUSHx(b)) \
+	X(STA, POP2(a) POPx(b) POKE(a, b)) \
+	X(DEI, POP1(a) DEVR(b, a) PUSHx(b)) \
+	X(DEO, POP1(a) POPx(b) DEVW(a, b)) \
+	X(ADD, POPx(a) POPx(b) PUSHx(b + a)) \
+	X(SUB, POPx(a) POPx(b) PUSHx(b - a)) \
+	X(MUL, POPx(a) POPx(b) PUSHx((Uint32)b * a)) \
+	X(DIV, POPx(a) POPx(b) if(!a) HALT(3) PUSHx(b / a)) \
+	X(AND, POPx(a) POPx(b) PUSHx(b & a)) \
+	X(ORA, POPx(a) POPx(b) PUSHx(b | a)) \
+	X(EOR, POPx(a) POPx(b) PUSHx(b ^ a)) \
+	X(SFT, POP1(a) POPx(b) PUSHx(b >> (a & 0xf) << (a >> 4)))
+
+#define T(name, body)    &&op_##name,
+#define T2(name, body)   &&op_##name##2,
+#define Tr(name, body)   &&op_##name##r,
+#define T2r(name, body)  &&op_##name##2r,
+#define Tk(name, body)   &&op_##name##k,
+#define T2k(name, body)  &&op_##name##2k,
+#define Tkr(name, body)  &&op_##name##kr,
+#define T2kr(name, body) &&op_##name##2kr,
+
+/* clang-format on */
+
+#ifdef UXN_BLOCKS
+/* The blocks engine falls back to this when it can't make a block, with the
+vector already checked and pc wherever it got to. The stores still drop the
+blocks they land on, as nested evals may make more. */
+#undef POKE
+#define POKE(x, y) { if(m2) { POKE2(ram + x, y) } else { ram[(x)] = (y); } uxn_invalidate(u, (x), 1 + m2); }
+static int
+uxn_interpret(Uxn *u, Uint16 pc)
+#else
 int
 uxn_eval(Uxn *u, Uint16 pc)
+#endif
 {
-	Uint8 ins, opc, m2, ksp, tsp, *sp, *ram = u->ram;
+	static void *table[0x100] = {
+		&&op_BRK, OPCODES(T) &&op_JCI, OPCODES(T2)
+		&&op_JMI, OPCODES(Tr) &&op_JSI, OPCODES(T2r)
+		&&op_LIT, OPCODES(Tk) &&op_LIT2, OPCODES(T2k)
+		&&op_LITr, OPCODES(Tkr) &&op_LIT2r, OPCODES(T2kr)};
+	Uint8 ins, tsp, *ram = u->ram;
+	Uint16 a, b, c, t, from;
+	Uint32 left = u->budget;
+#ifndef UXN_BLOCKS
+	if(!pc || u->dev[0x0f]) return 0;
+#endif
+	NEXT
+	/* Immediate */
+	op_BRK: return 1;
+	op_JCI: { Stack *s = &u->wst; Uint8 *sp = &s->ptr; POP1(b) if(!b) { pc += 2; NEXT } }
+	op_JMI: from = pc; pc += PEEK2(ram + pc) + 2; PREEMPT NEXT
+	op_JSI: { Stack *s = &u->rst; PUSH2(pc + 2) from = pc; pc += PEEK2(ram + pc) + 2; PREEMPT NEXT }
+	op_LIT: { Stack *s = &u->wst; PUSH1(ram[pc++]) NEXT }
+	op_LIT2: { Stack *s = &u->wst; PUSH2(PEEK2(ram + pc)) pc += 2; NEXT }
+	op_LITr: { Stack *s = &u->rst; PUSH1(ram[pc++]) NEXT }
+	op_LIT2r: { Stack *s = &u->rst; PUSH2(PEEK2(ram + pc)) pc += 2; NEXT }
+	/* ALU */
+	OPCODES(MODES)
+}
+
+#ifdef UXN_BLOCKS
+
+#include <stdlib.h>
+
+/* Translation cache: straight-line code up to the next jump is decoded once
+into a block of ops, each holding the handler for its opcode byte. A literal
+followed by the instruction consuming it runs as a single op. Blocks depend
+on opcode bytes only, operands are read as they run, so storing into a
+literal keeps the block. Writing over a decoded opcode byte drops the blocks
+that decoded it, and a block that gets dropped while running is left for a
+fresh one at the next instruction. */
+
+#define BLOCK_SPAN 0x100
+
+typedef struct {
+	void *code;
+	Uint16 pc; /* after the opcode byte */
+	Uint8 ins;
+} Op;
+
+typedef struct {
+	Uint32 end;
+	Uint16 len;
+	Op op[];
+} Block;
+
+/* each uxn gets a cache on its first uxn_eval, and gives it back in uxn_free */
+
+typedef struct {
+	Uint32 gen;
+	Block *at[0x10000];
+	Uint16 decoded[0x10000];
+} Cache;
+
+/* clang-format off */
+
+/* literal, fused instruction, its opcode byte, bytes it pops besides the literal */
+#define ALU(X, name, ins, body) X(LIT, name, ins, 1, body) X(LIT2, name##2, ins | 0x20, 2, body)
+#define FUSIONS(X) \
+	ALU(X, EQU, 0x08, POPx(b) PUSH1(b == a)) \
+	ALU(X, NEQ, 0x09, POPx(b) PUSH1(b != a)) \
+	ALU(X, GTH, 0x0a, POPx(b) PUSH1(b > a)) \
+	ALU(X, LTH, 0x0b, POPx(b) PUSH1(b < a)) \
+	ALU(X, ADD, 0x18, POPx(b) PUSHx(b + a)) \
+	ALU(X, SUB, 0x19, POPx(b) PUSHx(b - a)) \
+	ALU(X, MUL, 0x1a, POPx(b) PUSHx((Uint32)b * a)) \
+	ALU(X, AND, 0x1c, POPx(b) PUSHx(b & a)) \
+	ALU(X, ORA, 0x1d, POPx(b) PUSHx(b | a)) \
+	ALU(X, EOR, 0x1e, POPx(b) PUSHx(b ^ a)) \
+	X(LIT, SFT, 0x1f, 1, POPx(b) PUSHx(b >> (a & 0xf) << (a >> 4))) \
+	X(LIT, SFT2, 0x3f, 2, POPx(b) PUSHx(b >> (a & 0xf) << (a >> 4))) \
+	X(LIT, LDZ, 0x10, 0, PEEK(b, a) PUSHx(b)) \
+	X(LIT, LDZ2, 0x30, 0, PEEK(b, a) PUSHx(b)) \
+	X(LIT, STZ, 0x11, 1, POPx(b) POKE(a, b)) \
+	X(LIT, STZ2, 0x31, 2, POPx(b) POKE(a, b)) \
+	X(LIT, LDR, 0x12, 0, PEEK(b, pc + (Sint8)a) PUSHx(b)) \
+	X(LIT, LDR2, 0x32, 0, PEEK(b, pc + (Sint8)a) PUSHx(b)) \
+	X(LIT, STR, 0x13, 1, POPx(b) POKE(pc + (Sint8)a, b)) \
+	X(LIT, STR2, 0x33, 2, POPx(b) POKE(pc + (Sint8)a, b)) \
+	X(LIT, DEI, 0x16, 0, DEVR(b, a) PUSHx(b)) \
+	X(LIT, DEI2, 0x36, 0, DEVR(b, a) PUSHx(b)) \
+	X(LIT, DEO, 0x17, 1, POPx(b) DEVW(a, b)) \
+	X(LIT, DEO2, 0x37, 2, POPx(b) DEVW(a, b)) \
+	X(LIT2, LDA, 0x14, 0, PEEK(b, a) PUSHx(b)) \
+	X(LIT2, LDA2, 0x34, 0, PEEK(b, a) PUSHx(b)) \
+	X(LIT2, STA, 0x15, 1, POPx(b) POKE(a, b)) \
+	X(LIT2, STA2, 0x35, 2, POPx(b) POKE(a, b))
+
+/* a comparison with a literal followed by JCI also takes in the JCI */
+#define BRANCHES(X) \
+	X(LIT, EQU, 0x08, 1, b == a) X(LIT2, EQU2, 0x28, 2, b == a) \
+	X(LIT, NEQ, 0x09, 1, b != a) X(LIT2, NEQ2, 0x29, 2, b != a) \
+	X(LIT, GTH, 0x0a, 1, b > a) X(LIT2, GTH2, 0x2a, 2, b > a) \
+	X(LIT, LTH, 0x0b, 1, b < a) X(LIT2, LTH2, 0x2b, 2, b < a)
+
+#define LIT_INS 0x80
+#define LIT2_INS 0xa0
+#define W(lit, name, ins, need, body) [ins] = lit##_INS,
+
+/* clang-format on */
+
+static const Uint8 fuse_with[0x100] = {FUSIONS(W)};
+
+static void
+cache_free(Cache *cache, Block *b)
+{
+	Uint16 i;
+	for(i = 0; i < b->len; i++)
+		cache->decoded[(Uint16)(b->op[i].pc - 1)]--;
+	free(b);
+}
+
+static void
+cache_drop(Cache *cache, Uint16 addr)
+{
+	Uint32 i = addr >= BLOCK_SPAN ? addr - BLOCK_SPAN + 1 : 0;
+	for(; i <= addr; i++)
+		if(cache->at[i] && addr < cache->at[i]->end) {
+			cache_free(cache, cache->at[i]);
+			cache->at[i] = 0;
+		}
+	cache->gen++;
+}
+
+static Block *
+cache_fill(Cache *cache, Uint8 *ram, Uint16 pc, void **table, void **fused, void **branch, void *end)
+{
+	Op ops[BLOCK_SPAN];
+	Uint32 addr = pc, n = 0, i;
+	Uint8 ins, opc;
+	Block *b;
+	do {
+		ins = ram[addr];
+		opc = ins & 0x1f;
+		ops[n].code = table[ins];
+		ops[n].pc = addr + 1;
+		ops[n++].ins = ins;
+		addr += 1 + (ins == 0x80 || ins == 0xc0) + 2 * (ins == 0xa0 || ins == 0xe0);
+		if(!opc ? !(ins & 0x80) : opc >= 0x0c && opc <= 0x0e)
+			break; /* BRK, immediate jumps and JMP, JCN, JSR */
+	} while(addr - pc <= BLOCK_SPAN - 3 && addr <= 0xffff);
+	if(!(b = malloc(sizeof(Block) + (n + 1) * sizeof(Op))))
+		return 0;
+	b->end = addr;
+	b->len = n;
+	for(i = 0; i < n; i++) {
+		b->op[i] = ops[i];
+		cache->decoded[(Uint16)(ops[i].pc - 1)]++;
+		if(i + 1 == n || !fused[ins = ops[i + 1].ins] || fuse_with[ins] != ops[i].ins)
+			continue;
+		if(i + 2 < n && ops[i + 2].ins == 0x20 && branch[ins])
+			b->op[i].code = branch[ins];
+		else
+			b->op[i].code = fused[ins];
+	}
+	b->op[n].code = end;
+	b->op[n].pc = addr;
+	return cache->at[pc] = b;
+}
+
+void
+uxn_invalidate(Uxn *u, Uint16 addr, Uint32 len)
+{
+	Cache *cache = u->cache;
+	Uint32 i;
+	if(!cache)
+		return;
+	for(i = 0; i < len; i++)
+		if(cache->decoded[(Uint16)(addr + i)])
+			cache_drop(cache, addr + i);
+}
+
+void
+uxn_free(Uxn *u)
+{
+	Cache *cache = u->cache;
+	Uint32 i;
+	if(!cache)
+		return;
+	for(i = 0; i < 0x10000; i++)
+		if(cache->at[i])
+			cache_free(cache, cache->at[i]);
+	free(cache);
+	u->cache = 0;
+}
+
+/* Inside blocks, ops fetch their pc and instruction byte from the block.
+Stores over decoded code and device calls, that may do anything, mark the
+op to look for dropped blocks before moving on. The stack pointers live in
+wp and rp, and are only written back to the stacks when something outside
+could look at them: device calls, halts and leaving uxn_eval. */
+
+#undef HALT
+#undef FLIP
+#undef JUMP
+#undef NEXT
+#undef OP
+#undef POKE
+#undef DEVW
+#undef DEVR
+#undef PUSH1
+#undef PUSH2
+#define SPILL      { u->wst.ptr = wp; u->rst.ptr = rp; }
+#define RELOAD     { wp = u->wst.ptr; rp = u->rst.ptr; }
+#define HALT(c)    { SPILL return emu_halt(u, op->ins, (c), op->pc - 1); }
+#define FLIP       { s = r ? &u->wst : &u->rst; ptr = r ? &wp : &rp; }
+#define PUSH1(y)   { if(*ptr == 0xff) HALT(2) s->dat[(*ptr)++] = (y); }
+#define PUSH2(y)   { if((tsp = *ptr) >= 0xfe) HALT(2) t = (y); POKE2(&s->dat[tsp], t); *ptr = tsp + 2; }
+#define JUMP(x)    { if(m2) pc = (x); else pc += (Sint8)(x); goto jump; }
+#define NEXT       { op++; goto *op->code; }
+#define SYNC       { if(sync && gen != cache->gen) goto enter; }
+#define OP(name, M2, R, K, body) \
+	op_##name: { \
+		enum { m2 = M2, r = R }; \
+		Stack *s = r ? &u->rst : &u->wst; \
+		Uint8 *ptr = r ? &rp : &wp, ksp = *ptr, *sp = K ? &ksp : ptr; \
+		int sync = 0; \
+		pc = op->pc; \
+		body \
+		SYNC \
+		NEXT \
+	}
+#define POKE(x, y) { \
+		int w = (x); \
+		if(m2) { POKE2(ram + w, y) } else { ram[w] = (y); } \
+		if(cache->decoded[w & 0xffff]) cache_drop(cache, w); \
+		if(m2 && cache->decoded[(w + 1) & 0xffff]) cache_drop(cache, w + 1); \
+		sync = 1; \
+	}
+#define DEVW(p, y) { SPILL if(m2) { DEO(p, y >> 8) DEO((p + 1), y) } else { DEO(p, y) } RELOAD sync = 1; }
+#define DEVR(o, p) { SPILL if(m2) { o = DEI(p) << 8 | DEI(p + 1); } else { o = DEI(p); } RELOAD sync = 1; }
+
+/* A fused op leaves the literal above the stack, where pushing and popping
+it would have, and leaves it to the unfused ops when either could halt. */
+
+#define LIT_ARG    { a = ram[op->pc]; s->dat[wp] = a; }
+#define LIT2_ARG   { a = PEEK2(ram + op->pc); POKE2(&s->dat[wp], a) }
+#define FUSE(lit, name, INS, need, body) \
+	op_##lit##_##name: { \
+		enum { m2 = (INS) & 0x20 }; \
+		Stack *s = &u->wst; \
+		Uint8 *ptr = &wp, *sp = ptr; (void)sp; \
+		int sync = 0; \
+		if(wp < need || wp > 0xf8) goto op_##lit; \
+		lit##_ARG \
+		pc = op[1].pc; \
+		body \
+		SYNC \
+		op++; \
+		NEXT \
+	}
+#define BRANCH(lit, name, INS, need, test) \
+	op_##lit##_##name##_JCI: { \
+		enum { m2 = (INS) & 0x20 }; \
+		Stack *s = &u->wst; \
+		Uint8 *sp = &wp; \
+		if(wp < need || wp > 0xf8) goto op_##lit; \
+		lit##_ARG \
+		POPx(b) \
+		s->dat[wp] = test; \
+		pc = op[2].pc; \
+		if(test) pc += PEEK2(ram + pc); \
+		pc += 2; \
+		goto jump; \
+	}
+#define F(lit, name, ins, need, body) [ins] = &&op_##lit##_##name,
+#define B(lit, name, ins, need, test) [ins] = &&op_##lit##_##name##_JCI,
+
+int
+uxn_eval(Uxn *u, Uint16 pc)
+{
+	static void *table[0x100] = {
+		&&op_BRK, OPCODES(T) &&op_JCI, OPCODES(T2)
+		&&op_JMI, OPCODES(Tr) &&op_JSI, OPCODES(T2r)
+		&&op_LIT, OPCODES(Tk) &&op_LIT2, OPCODES(T2k)
+		&&op_LITr, OPCODES(Tkr) &&op_LIT2r, OPCODES(T2kr)};
+	static void *fused[0x100] = {FUSIONS(F)};
+	static void *branch[0x100] = {BRANCHES(B)};
+	Uint8 tsp, wp, rp, *ram = u->ram;
 	Uint16 a, b, c, t;
+	Uint32 gen, left = u->budget;
+	Cache *cache = u->cache;
+	Block *block;
+	Op *op;
+	if(!pc || u->dev[0x0f]) return 0;
+	if(!cache && !(cache = u->cache = calloc(1, sizeof(Cache)))) return uxn_interpret(u, pc);
+	RELOAD
+	goto enter;
+jump:
+	if(pc < op->pc && !--left && u->budget) {
+		SPILL
+		u->resume = pc;
+		return 1;
+	}
+enter:
+	if(!(block = cache->at[pc]) && !(block = cache_fill(cache, ram, pc, table, fused, branch, &&op_END))) {
+		SPILL
+		return uxn_interpret(u, pc);
+	}
+	gen = cache->gen;
+	op = block->op;
+	goto *op->code;
+	op_END: pc = op->pc; goto enter;
+	/* Immediate */
+	op_BRK: SPILL return 1;
+	op_JCI: { Stack *s = &u->wst; Uint8 *sp = &wp; pc = op->pc; POP1(b) if(!b) { pc += 2; goto enter; } }
+		pc += PEEK2(ram + pc) + 2; goto jump;
+	op_JMI: pc = op->pc; pc += PEEK2(ram + pc) + 2; goto jump;
+	op_JSI: { Stack *s = &u->rst; Uint8 *ptr = &rp; pc = op->pc; PUSH2(pc + 2) pc += PEEK2(ram + pc) + 2; goto jump; }
+	op_LIT: { Stack *s = &u->wst; Uint8 *ptr = &wp; PUSH1(ram[op->pc]) NEXT }
+	op_LIT2: { Stack *s = &u->wst; Uint8 *ptr = &wp; PUSH2(PEEK2(ram + op->pc)) NEXT }
+	op_LITr: { Stack *s = &u->rst; Uint8 *ptr = &rp; PUSH1(ram[op->pc]) NEXT }
+	op_LIT2r: { Stack *s = &u->rst; Uint8 *ptr = &rp; PUSH2(PEEK2(ram + op->pc)) NEXT }
+	/* ALU */
+	OPCODES(MODES)
+	/* Fused */
+	FUSIONS(FUSE)
+	BRANCHES(BRANCH)
+}
+
+#else
+
+void
+uxn_invalidate(Uxn *u, Uint16 addr, Uint32 len)
+{
+}
+
+void
+uxn_free(Uxn *u)
+{
+}
+
+#endif
+
+#else
+
+int
+uxn_eval(Uxn *u, Uint16 pc)
+{
+	Uint8 ins, opc, m2, ksp, tsp, *sp, *ram = u->ram;
+	Uint16 a, b, c, t, from;
+	Uint32 left = u->budget;
 	Stack *s;
 	if(!pc || u->dev[0x0f]) return 0;
+	profile_vector(u, pc);
 	for(;;) {
 		ins = ram[pc++];
+		profile_step(u, pc - 1, ins);
 		/* modes */
 		opc = ins & 0x1f;
 		m2 = ins & 0x20;
@@ -44,8 +480,8 @@ uxn_eval(Uxn *u, Uint16 pc)
 		/* Immediate */
 		case -0x0: /* BRK   */ return 1;
 		case -0x1: /* JCI   */ POP1(b) if(!b) { pc += 2; break; } /* else fallthrough */
-		case -0x2: /* JMI   */ pc += PEEK2(ram + pc) + 2; break;
-		case -0x3: /* JSI   */ PUSH2(pc + 2) pc += PEEK2(ram + pc) + 2; break;
+		case -0x2: /* JMI   */ from = pc; pc += PEEK2(ram + pc) + 2; PREEMPT break;
+		case -0x3: /* JSI   */ PUSH2(pc + 2) from = pc; pc += PEEK2(ram + pc) + 2; PREEMPT break;
 		case -0x4: /* LIT   */
 		case -0x6: /* LITr  */ PUSH1(ram[pc++]) break;
 		case -0x5: /* LIT2  */
@@ -86,6 +522,18 @@ uxn_eval(Uxn *u, Uint16 pc)
 	}
 }
 
+void
+uxn_invalidate(Uxn *u, Uint16 addr, Uint32 len)
+{
+}
+
+void
+uxn_free(Uxn *u)
+{
+}
+
+#endif
+
 int
 uxn_boot(Uxn *u, Uint8 *ram)
 {
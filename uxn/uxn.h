@@ -13,8 +13,8 @@ WITH REGARD TO THIS SOFTWARE.
 
 #define POKE2(d, v) { (d)[0] = (v) >> 8; (d)[1] = (v); }
 #define PEEK2(d) ((d)[0] << 8 | (d)[1])
-#define DEO(p, v) { u->dev[p] = v; if((deo_mask[p >> 4] >> (p & 0xf)) & 0x1) emu_deo(u, p); }
-#define DEI(p) ((dei_mask[(p) >> 4] >> ((p) & 0xf)) & 0x1 ? emu_dei(u, (p)) : u->dev[(p)])
+#define DEO(p, v) { u->dev[p] = v; if((u->deo_mask[p >> 4] >> (p & 0xf)) & 0x1) emu_deo(u, p); }
+#define DEI(p) ((u->dei_mask[(p) >> 4] >> ((p) & 0xf)) & 0x1 ? emu_dei(u, (p)) : u->dev[(p)])
 
 /* clang-format on */
 
@@ -35,6 +35,11 @@ typedef struct Uxn {
 	Stack wst, rst;
 	Uint8 (*dei)(struct Uxn *u, Uint8 addr);
 	void (*deo)(struct Uxn *u, Uint8 addr);
+	Uint32 budget; /* backward jumps uxn_eval takes before yielding, 0 for no limit */
+	Uint16 resume; /* where the vector that yielded carries on, left for the caller */
+	Uint16 dev_vers[0x10], dei_mask[0x10], deo_mask[0x10]; /* see system_connect */
+	struct Varvara *emu; /* the state of the devices, see varvara.h */
+	void *cache; /* translated blocks, shared with the uxns running on the same ram */
 } Uxn;
 
 /* required functions */
@@ -42,9 +47,10 @@ typedef struct Uxn {
 extern Uint8 emu_dei(Uxn *u, Uint8 addr);
 extern void emu_deo(Uxn *u, Uint8 addr);
 extern int emu_halt(Uxn *u, Uint8 instr, Uint8 err, Uint16 addr);
-extern Uint16 dev_vers[0x10], dei_mask[0x10], deo_mask[0x10];
 
 /* built-ins */
 
 int uxn_boot(Uxn *u, Uint8 *ram);
 int uxn_eval(Uxn *u, Uint16 pc);
+void uxn_invalidate(Uxn *u, Uint16 addr, Uint32 len);
+void uxn_free(Uxn *u);
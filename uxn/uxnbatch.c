@@ -0,0 +1,314 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "uxn.h"
+#include "devices/system.h"
+#include "devices/console.h"
+#include "devices/screen.h"
+#include "devices/audio.h"
+#include "devices/file.h"
+#include "devices/datetime.h"
+#include "varvara.h"
+#ifdef UXN_PROFILE
+#include "profile.h"
+#endif
+
+/* Headless Varvara for many roms at once, the devices of uxncli on a pool of
+threads. Every thread has a machine of its own and runs roms on it one after
+the other, from its share of the list. A thread done with its share steals the
+later half of what is left of another's, so the roms that run long don't keep
+the others waiting. What the roms write to the console is kept, and printed in
+the order they were given once they all ran. */
+
+#define WIDTH 64 * 8
+#define HEIGHT 40 * 8
+
+#define FAILED -1 /* the rom could not be loaded */
+#define STUCK -2 /* a vector ran out of the limit */
+
+typedef struct {
+	char *rom, *out, *err;
+	size_t outlen, errlen;
+	int status; /* what the rom exited with, or FAILED or STUCK */
+} Task;
+
+typedef struct {
+	Uxn u;
+	Varvara v;
+	pthread_t thread;
+	pthread_mutex_t lock;
+	int top, bottom; /* the tasks left in this worker's share */
+	int started;
+} Worker;
+
+static Task *tasks;
+static Worker *workers;
+static int threads, frames;
+static Uint32 limit;
+
+static double
+now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+Uint8
+emu_dei(Uxn *u, Uint8 addr)
+{
+	switch(addr & 0xf0) {
+	case 0x20: return screen_dei(&u->emu->screen, u, addr);
+	case 0xc0: return datetime_dei(u, addr);
+	}
+	return u->dev[addr];
+}
+
+void
+emu_deo(Uxn *u, Uint8 addr)
+{
+	Uint8 p = addr & 0x0f, d = addr & 0xf0;
+	switch(d) {
+	case 0x00:
+		system_deo(u, &u->dev[d], p);
+		if(p > 0x7 && p < 0xe)
+			screen_palette(&u->emu->screen, &u->dev[0x8]);
+		break;
+	case 0x10: console_deo(&u->dev[d], p, u->emu->out, u->emu->err); break;
+	case 0x20: screen_deo(&u->emu->screen, u->ram, &u->dev[d], p); break;
+	case 0xa0: file_deo(&u->emu->file[0], u, &u->dev[d], p); break;
+	case 0xb0: file_deo(&u->emu->file[1], u, &u->dev[d], p); break;
+	}
+}
+
+int
+emu_resize(UxnScreen *scr, int width, int height)
+{
+	return 1;
+}
+
+Uint32 *
+emu_lock(UxnScreen *scr, int x, int y, int width, int height, int *pitch)
+{
+	return NULL;
+}
+
+void
+emu_update(UxnScreen *scr, int x, int y, int width, int height)
+{
+}
+
+static void
+emu_connect(Uxn *u, Varvara *v)
+{
+	u->emu = v;
+	system_connect(u, 0x0, SYSTEM_VERSION, SYSTEM_DEIMASK, SYSTEM_DEOMASK);
+	system_connect(u, 0x1, CONSOLE_VERSION, CONSOLE_DEIMASK, CONSOLE_DEOMASK);
+	system_connect(u, 0x2, SCREEN_VERSION, SCREEN_DEIMASK, SCREEN_DEOMASK);
+	system_connect(u, 0xa, FILE_VERSION, FILE_DEIMASK, FILE_DEOMASK);
+	system_connect(u, 0xb, FILE_VERSION, FILE_DEIMASK, FILE_DEOMASK);
+	system_connect(u, 0xc, DATETIME_VERSION, DATETIME_DEIMASK, DATETIME_DEOMASK);
+}
+
+/* screen_resize keeps the layers when the size is the same, the worker's last
+rom drew on them */
+
+static void
+clear_screen(UxnScreen *scr)
+{
+	screen_resize(scr, WIDTH, HEIGHT);
+	if(scr->layers)
+		memset(scr->layers, 0, (scr->width * scr->height + 1) / 2);
+	memset(scr->palette, 0, sizeof(scr->palette));
+	memset(scr->tiles, 0, sizeof(scr->tiles));
+	scr->changed = 0;
+}
+
+/* with a limit, a vector that yields is taken to be stuck, and u->resume
+tells so to the caller */
+
+static int
+eval(Uxn *u, Uint16 pc)
+{
+	u->resume = 0;
+	return uxn_eval(u, pc) && !u->resume;
+}
+
+static void
+run_task(Worker *w, Task *t)
+{
+	Uxn *u = &w->u;
+	Uint8 *ram = u->ram;
+	void *cache = u->cache;
+	int i;
+	t->status = FAILED;
+	w->v.out = open_memstream(&t->out, &t->outlen);
+	w->v.err = open_memstream(&t->err, &t->errlen);
+	if(!w->v.out || !w->v.err)
+		goto done;
+	/* the ram and the cache of blocks go from one rom to the next */
+	system_ram_clear(ram);
+	uxn_boot(u, ram);
+	u->cache = cache;
+	u->budget = limit;
+	emu_connect(u, &w->v);
+	if(!system_load(u, t->rom))
+		goto done;
+	clear_screen(&w->v.screen);
+	if(eval(u, PAGE_PROGRAM)) {
+		/* the screen vector, as if the frames went by */
+		for(i = frames; i > 0 && !u->dev[0x0f] && !u->resume; i--)
+			eval(u, PEEK2(&u->dev[0x20]));
+		/* and stdin, empty */
+		if(!u->dev[0x0f] && !u->resume) {
+			u->dev[0x12] = 0x00;
+			u->dev[0x17] = CONSOLE_END;
+			eval(u, PEEK2(&u->dev[0x10]));
+		}
+	}
+	t->status = u->resume ? STUCK : u->dev[0x0f] & 0x7f;
+done:
+	for(i = 0; i < POLYFILEY; i++)
+		file_reset(&w->v.file[i]);
+	if(w->v.out)
+		fclose(w->v.out);
+	if(w->v.err)
+		fclose(w->v.err);
+}
+
+/* The worker runs its share from the top, thieves take from the bottom. */
+
+static int
+take(Worker *w)
+{
+	int task = -1;
+	pthread_mutex_lock(&w->lock);
+	if(w->top < w->bottom)
+		task = w->top++;
+	pthread_mutex_unlock(&w->lock);
+	return task;
+}
+
+static int
+steal(Worker *w)
+{
+	int i, n, from;
+	for(i = 1; i < threads; i++) {
+		Worker *victim = &workers[(w - workers + i) % threads];
+		pthread_mutex_lock(&victim->lock);
+		n = (victim->bottom - victim->top + 1) / 2;
+		from = victim->bottom -= n;
+		pthread_mutex_unlock(&victim->lock);
+		if(!n)
+			continue;
+		pthread_mutex_lock(&w->lock);
+		w->top = from + 1;
+		w->bottom = from + n;
+		pthread_mutex_unlock(&w->lock);
+		return from;
+	}
+	return -1;
+}
+
+static void *
+work(void *arg)
+{
+	Worker *w = arg;
+	int task;
+	while((task = take(w)) >= 0 || (task = steal(w)) >= 0)
+		run_task(w, &tasks[task]);
+	return NULL;
+}
+
+int
+main(int argc, char **argv)
+{
+	Uxn u = {0};
+	Varvara v = {0};
+	int i = 1, j, n, failed = 0, timing = 0;
+	double start;
+	if(i == argc)
+		return system_error("usage", "uxnbatch [-v][-t][-j threads][-f frames][-l jumps] file.rom..");
+	if(argv[i][0] == '-' && argv[i][1] == 'v') {
+		emu_connect(&u, &v);
+		return system_version(&u, "Uxnbatch - Console Varvara Emulator, for many roms", "8 Aug 2023");
+	}
+	for(; i < argc && argv[i][0] == '-'; i++) {
+		if(strcmp(argv[i], "-t") == 0)
+			timing = 1;
+		else if(strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+			threads = atoi(argv[++i]);
+		else if(strcmp(argv[i], "-f") == 0 && i + 1 < argc)
+			frames = atoi(argv[++i]);
+		else if(strcmp(argv[i], "-l") == 0 && i + 1 < argc)
+			limit = strtoul(argv[++i], NULL, 0);
+		else
+			return system_error("usage", "uxnbatch [-v][-t][-j threads][-f frames][-l jumps] file.rom..");
+	}
+	if(!(n = argc - i))
+		return system_error("usage", "uxnbatch [-v][-t][-j threads][-f frames][-l jumps] file.rom..");
+	if(threads <= 0)
+		threads = sysconf(_SC_NPROCESSORS_ONLN);
+#ifdef UXN_PROFILE
+	/* the profiler counts into globals */
+	threads = 1;
+#endif
+	if(threads > n)
+		threads = n;
+	if(threads < 1)
+		threads = 1;
+	if(!(tasks = calloc(n, sizeof(Task))) || !(workers = calloc(threads, sizeof(Worker))))
+		return system_error("Init", "Out of memory.");
+	for(j = 0; j < n; j++)
+		tasks[j].rom = argv[i + j];
+	for(j = 0; j < threads; j++) {
+		Worker *w = &workers[j];
+		w->top = j * n / threads;
+		w->bottom = (j + 1) * n / threads;
+		pthread_mutex_init(&w->lock, NULL);
+		if(!(w->u.ram = system_ram()))
+			return system_error("Boot", "Failed");
+	}
+	/* a thread that fails to start leaves its share to be stolen */
+	start = now();
+	for(j = 1; j < threads; j++)
+		workers[j].started = !pthread_create(&workers[j].thread, NULL, work, &workers[j]);
+	work(&workers[0]);
+	for(j = 1; j < threads; j++)
+		if(workers[j].started)
+			pthread_join(workers[j].thread, NULL);
+	start = now() - start;
+	for(j = 0; j < n; j++) {
+		Task *t = &tasks[j];
+		fwrite(t->out, 1, t->outlen, stdout);
+		fwrite(t->err, 1, t->errlen, stderr);
+		if(t->status == FAILED)
+			fprintf(stderr, "%s: failed to run\n", t->rom);
+		else if(t->status == STUCK)
+			fprintf(stderr, "%s: stuck, over %u backward jumps in a vector\n", t->rom, limit);
+		else if(t->status)
+			fprintf(stderr, "%s: exited with %d\n", t->rom, t->status);
+		failed += !!t->status;
+		free(t->out);
+		free(t->err);
+	}
+	if(timing)
+		fprintf(stderr, "%d roms, %d failed, in %.3f s on %d threads\n", n, failed, start, threads);
+#ifdef UXN_PROFILE
+	profile_report();
+#endif
+	for(j = 0; j < threads; j++) {
+		Worker *w = &workers[j];
+		uxn_free(&w->u);
+		system_ram_free(w->u.ram);
+		free(w->v.screen.pixels);
+		free(w->v.screen.layers);
+	}
+	free(workers);
+	free(tasks);
+	return !!failed;
+}
@@ -0,0 +1,237 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "uxn.h"
+#include "devices/system.h"
+#include "devices/console.h"
+#include "devices/screen.h"
+#include "devices/audio.h"
+#include "devices/file.h"
+#include "devices/datetime.h"
+#include "varvara.h"
+#include "snapshot.h"
+#ifdef UXN_PROFILE
+#include "profile.h"
+#endif
+
+/*
+Copyright (c) 2021-2023 Devine Lu Linvega, Andrew Alderwick
+
+Permission to use, copy, modify, and distribute this software for any
+purpose with or without fee is hereby granted, provided that the above
+copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+WITH REGARD TO THIS SOFTWARE.
+*/
+
+/* Headless Varvara: the console, file, datetime and system devices, and a
+screen drawn in memory only. Nothing here touches SDL, so roms run in
+pipelines at the full speed of the interpreter. */
+
+#define WIDTH 64 * 8
+#define HEIGHT 40 * 8
+
+static Varvara varvara;
+static int timing;
+static double eval_time;
+static unsigned long eval_count;
+
+static double
+now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int
+eval(Uxn *u, Uint16 pc)
+{
+	double start;
+	int res;
+	if(!timing)
+		return uxn_eval(u, pc);
+	start = now();
+	res = uxn_eval(u, pc);
+	eval_time += now() - start;
+	eval_count++;
+	return res;
+}
+
+static int
+console(Uxn *u, char c, int type)
+{
+	Uint8 *d = &u->dev[0x10];
+	d[0x2] = c;
+	d[0x7] = type;
+	return eval(u, PEEK2(d));
+}
+
+Uint8
+emu_dei(Uxn *u, Uint8 addr)
+{
+	switch(addr & 0xf0) {
+	case 0x20: return screen_dei(&u->emu->screen, u, addr);
+	case 0xc0: return datetime_dei(u, addr);
+	}
+	return u->dev[addr];
+}
+
+void
+emu_deo(Uxn *u, Uint8 addr)
+{
+	Uint8 p = addr & 0x0f, d = addr & 0xf0;
+	switch(d) {
+	case 0x00:
+		system_deo(u, &u->dev[d], p);
+		if(p > 0x7 && p < 0xe)
+			screen_palette(&u->emu->screen, &u->dev[0x8]);
+		break;
+	case 0x10: console_deo(&u->dev[d], p, u->emu->out, u->emu->err); break;
+	case 0x20: screen_deo(&u->emu->screen, u->ram, &u->dev[d], p); break;
+	case 0xa0: file_deo(&u->emu->file[0], u, &u->dev[d], p); break;
+	case 0xb0: file_deo(&u->emu->file[1], u, &u->dev[d], p); break;
+	}
+}
+
+int
+emu_resize(UxnScreen *scr, int width, int height)
+{
+	return 1;
+}
+
+Uint32 *
+emu_lock(UxnScreen *scr, int x, int y, int width, int height, int *pitch)
+{
+	return NULL;
+}
+
+void
+emu_update(UxnScreen *scr, int x, int y, int width, int height)
+{
+}
+
+int
+emu_snapshot_audio(Uxn *u, Uint8 *state, int save)
+{
+	return 0;
+}
+
+static void
+emu_connect(Uxn *u, Varvara *v)
+{
+	u->emu = v;
+	system_connect(u, 0x0, SYSTEM_VERSION, SYSTEM_DEIMASK, SYSTEM_DEOMASK);
+	system_connect(u, 0x1, CONSOLE_VERSION, CONSOLE_DEIMASK, CONSOLE_DEOMASK);
+	system_connect(u, 0x2, SCREEN_VERSION, SCREEN_DEIMASK, SCREEN_DEOMASK);
+	system_connect(u, 0xa, FILE_VERSION, FILE_DEIMASK, FILE_DEOMASK);
+	system_connect(u, 0xb, FILE_VERSION, FILE_DEIMASK, FILE_DEOMASK);
+	system_connect(u, 0xc, DATETIME_VERSION, DATETIME_DEIMASK, DATETIME_DEOMASK);
+}
+
+static int
+save_screen(UxnScreen *scr, char *filename)
+{
+	int i, n = scr->width * scr->height;
+	FILE *f = fopen(filename, "wb");
+	if(!f)
+		return system_error("Screen", "Failed to save.");
+	screen_change(scr, 0, 0, scr->width, scr->height);
+	screen_redraw(scr);
+	fprintf(f, "P6\n%d %d\n255\n", scr->width, scr->height);
+	for(i = 0; i < n; i++) {
+		Uint32 c = scr->pixels[i];
+		fputc(c >> 16, f);
+		fputc(c >> 8, f);
+		fputc(c, f);
+	}
+	fclose(f);
+	return 1;
+}
+
+int
+main(int argc, char **argv)
+{
+	Uxn u = {0};
+	int i = 1, frames = 0;
+	char *rom, *screenshot = NULL, *stacks = NULL, *resume = NULL, *snapshot = NULL;
+	if(i == argc)
+		return system_error("usage", "uxncli [-v][-t][-f frames][-s file.ppm][-r file.snap][-w file.snap] file.rom [args..]");
+	/* Read flags */
+	if(argv[i][0] == '-' && argv[i][1] == 'v') {
+		emu_connect(&u, &varvara);
+		return system_version(&u, "Uxncli - Console Varvara Emulator", "8 Aug 2023");
+	}
+	for(; i < argc - 1 && argv[i][0] == '-'; i++) {
+		if(strcmp(argv[i], "-t") == 0)
+			timing = 1;
+		else if(strcmp(argv[i], "-f") == 0 && i + 2 < argc)
+			frames = atoi(argv[++i]);
+		else if(strcmp(argv[i], "-s") == 0 && i + 2 < argc)
+			screenshot = argv[++i];
+		else if(strcmp(argv[i], "-r") == 0 && i + 2 < argc)
+			resume = argv[++i];
+		else if(strcmp(argv[i], "-w") == 0 && i + 2 < argc)
+			snapshot = argv[++i];
+#ifdef UXN_PROFILE
+		else if(strcmp(argv[i], "-p") == 0 && i + 2 < argc)
+			stacks = argv[++i];
+#endif
+		else
+			return system_error("usage", "uxncli [-v][-t][-f frames][-s file.ppm][-r file.snap][-w file.snap] file.rom [args..]");
+	}
+	rom = argv[i++];
+	if(!uxn_boot(&u, system_ram()))
+		return system_error("Boot", "Failed");
+	/* Connect Varvara */
+	emu_connect(&u, &varvara);
+	varvara.out = stdout;
+	varvara.err = stderr;
+	if(!system_load(&u, rom))
+		return system_error("Load", "Failed");
+#ifdef UXN_PROFILE
+	profile_load(rom);
+#endif
+	screen_resize(&varvara.screen, WIDTH, HEIGHT);
+	u.dev[0x17] = argc - i;
+	/* a snapshot stands in for the reset vector */
+	if(resume && !uxn_snapshot_load(&u, resume))
+		return system_error("Snapshot", "Failed to load.");
+	if(resume || eval(&u, PAGE_PROGRAM)) {
+		for(; i < argc; i++) {
+			char *p = argv[i];
+			while(*p) console(&u, *p++, CONSOLE_ARG);
+			console(&u, '\n', i == argc - 1 ? CONSOLE_END : CONSOLE_EOA);
+		}
+		/* the screen vector, as if the frames went by */
+		for(; frames > 0 && !u.dev[0x0f]; frames--)
+			eval(&u, PEEK2(&u.dev[0x20]));
+		while(!u.dev[0x0f]) {
+			int c = fgetc(stdin);
+			if(c == EOF) {
+				console(&u, 0x00, CONSOLE_END);
+				break;
+			}
+			console(&u, (Uint8)c, CONSOLE_STD);
+		}
+	}
+	if(screenshot)
+		save_screen(&varvara.screen, screenshot);
+	if(snapshot && !uxn_snapshot_save(&u, snapshot))
+		system_error("Snapshot", "Failed to save.");
+	if(timing)
+		fprintf(stderr, "%s: %.3f ms in %lu vectors\n", rom, eval_time * 1e3, eval_count);
+#ifdef UXN_PROFILE
+	profile_report();
+	if(stacks && !profile_save(stacks))
+		system_error("Profile", "Failed to save.");
+#else
+	(void)stacks;
+#endif
+	uxn_free(&u);
+	system_ram_free(u.ram);
+	return u.dev[0x0f] & 0x7f;
+}
@@ -17,6 +17,11 @@
 #include "devices/controller.h"
 #include "devices/mouse.h"
 #include "devices/datetime.h"
+#include "varvara.h"
+#include "snapshot.h"
+#ifdef UXN_PROFILE
+#include "profile.h"
+#endif
 #if defined(_WIN32) && defined(_WIN32_WINNT) && _WIN32_WINNT > 0x0602
 #include <processthreadsapi.h>
 #elif defined(_WIN32)
@@ -44,10 +49,11 @@ WITH REGARD TO THIS SOFTWARE.
 #define PAD2 4
 #define WIDTH 64 * 8
 #define HEIGHT 40 * 8
-#define TIMEOUT_MS 334
+#define BUDGET 0x40000 /* backward jumps in a frame before handling events again */
 
 static SDL_Window *emu_window;
 static SDL_Texture *emu_texture;
+static int texture_locked;
 static SDL_Renderer *emu_renderer;
 static SDL_Rect emu_viewport;
 static SDL_AudioDeviceID audio_id;
@@ -57,10 +63,9 @@ static SDL_Thread *stdin_thread;
 
 static int window_created = 0;
 static Uint32 stdin_event, audio0_event, zoom = 1;
-static Uint64 exec_deadline, deadline_interval, ms_interval;
-static char *rom_path;
-
-Uint16 dev_vers[0x10], dei_mask[0x10], deo_mask[0x10];
+static Uint64 ms_interval;
+static char *rom_path, *resume_path;
+static Varvara varvara;
 
 static int
 clamp(int v, int min, int max)
@@ -70,23 +75,23 @@ clamp(int v, int min, int max)
 }
 
 static Uint8
-audio_dei(int instance, Uint8 *d, Uint8 port)
+audio_dei(UxnAudio *c, Uint8 *d, Uint8 port)
 {
 	if(!audio_id) return d[port];
 	switch(port) {
-	case 0x4: return audio_get_vu(instance);
-	case 0x2: POKE2(d + 0x2, audio_get_position(instance)); /* fall through */
+	case 0x4: return audio_get_vu(c);
+	case 0x2: POKE2(d + 0x2, audio_get_position(c)); /* fall through */
 	default: return d[port];
 	}
 }
 
 static void
-audio_deo(int instance, Uint8 *d, Uint8 port, Uxn *u)
+audio_deo(UxnAudio *c, Uint8 *d, Uint8 port, Uxn *u)
 {
 	if(!audio_id) return;
 	if(port == 0xf) {
 		SDL_LockAudioDevice(audio_id);
-		audio_start(instance, d, u);
+		audio_start(c, d, u);
 		SDL_UnlockAudioDevice(audio_id);
 		SDL_PauseAudioDevice(audio_id, 0);
 	}
@@ -97,11 +102,11 @@ emu_dei(Uxn *u, Uint8 addr)
 {
 	Uint8 p = addr & 0x0f, d = addr & 0xf0;
 	switch(d) {
-	case 0x20: return screen_dei(u, addr);
-	case 0x30: return audio_dei(0, &u->dev[d], p);
-	case 0x40: return audio_dei(1, &u->dev[d], p);
-	case 0x50: return audio_dei(2, &u->dev[d], p);
-	case 0x60: return audio_dei(3, &u->dev[d], p);
+	case 0x20: return screen_dei(&u->emu->screen, u, addr);
+	case 0x30: return audio_dei(&u->emu->audio[0], &u->dev[d], p);
+	case 0x40: return audio_dei(&u->emu->audio[1], &u->dev[d], p);
+	case 0x50: return audio_dei(&u->emu->audio[2], &u->dev[d], p);
+	case 0x60: return audio_dei(&u->emu->audio[3], &u->dev[d], p);
 	case 0xc0: return datetime_dei(u, addr);
 	}
 	return u->dev[addr];
@@ -115,39 +120,56 @@ emu_deo(Uxn *u, Uint8 addr)
 	case 0x00:
 		system_deo(u, &u->dev[d], p);
 		if(p > 0x7 && p < 0xe)
-			screen_palette(&u->dev[0x8]);
+			screen_palette(&u->emu->screen, &u->dev[0x8]);
 		break;
-	case 0x10: console_deo(&u->dev[d], p); break;
-	case 0x20: screen_deo(u->ram, &u->dev[d], p); break;
-	case 0x30: audio_deo(0, &u->dev[d], p, u); break;
-	case 0x40: audio_deo(1, &u->dev[d], p, u); break;
-	case 0x50: audio_deo(2, &u->dev[d], p, u); break;
-	case 0x60: audio_deo(3, &u->dev[d], p, u); break;
-	case 0xa0: file_deo(0, u->ram, &u->dev[d], p); break;
-	case 0xb0: file_deo(1, u->ram, &u->dev[d], p); break;
+	case 0x10: console_deo(&u->dev[d], p, u->emu->out, u->emu->err); break;
+	case 0x20: screen_deo(&u->emu->screen, u->ram, &u->dev[d], p); break;
+	case 0x30: audio_deo(&u->emu->audio[0], &u->dev[d], p, u); break;
+	case 0x40: audio_deo(&u->emu->audio[1], &u->dev[d], p, u); break;
+	case 0x50: audio_deo(&u->emu->audio[2], &u->dev[d], p, u); break;
+	case 0x60: audio_deo(&u->emu->audio[3], &u->dev[d], p, u); break;
+	case 0xa0: file_deo(&u->emu->file[0], u, &u->dev[d], p); break;
+	case 0xb0: file_deo(&u->emu->file[1], u, &u->dev[d], p); break;
 	}
 }
 
+int
+emu_snapshot_audio(Uxn *u, Uint8 *state, int save)
+{
+	int instance;
+	if(!audio_id) return 0;
+	SDL_LockAudioDevice(audio_id);
+	for(instance = 0; instance < POLYPHONY; instance++)
+		if(save)
+			audio_save(&u->emu->audio[instance], u->ram, state + instance * AUDIO_SNAPSHOT);
+		else
+			audio_load(&u->emu->audio[instance], u->ram, state + instance * AUDIO_SNAPSHOT);
+	SDL_UnlockAudioDevice(audio_id);
+	if(!save)
+		SDL_PauseAudioDevice(audio_id, 0);
+	return 1;
+}
+
 /* Handlers */
 
 static void
-audio_callback(void *u, Uint8 *stream, int len)
+audio_callback(void *emu, Uint8 *stream, int len)
 {
+	Varvara *v = emu;
 	int instance, running = 0;
 	Sint16 *samples = (Sint16 *)stream;
-	USED(u);
 	SDL_memset(stream, 0, len);
 	for(instance = 0; instance < POLYPHONY; instance++)
-		running += audio_render(instance, samples, samples + len / 2);
+		running += audio_render(&v->audio[instance], samples, samples + len / 2);
 	if(!running)
 		SDL_PauseAudioDevice(audio_id, 1);
 }
 
 void
-audio_finished_handler(int instance)
+audio_finished_handler(UxnAudio *c)
 {
 	SDL_Event event;
-	event.type = audio0_event + instance;
+	event.type = audio0_event + (c - varvara.audio);
 	SDL_PushEvent(&event);
 }
 
@@ -180,44 +202,70 @@ set_zoom(Uint8 z, int win)
 	if(z >= 1) {
 		zoom = z;
 		if(win)
-			set_window_size(emu_window, (uxn_screen.width + PAD2) * zoom, (uxn_screen.height + PAD2) * zoom);
+			set_window_size(emu_window, (varvara.screen.width + PAD2) * zoom, (varvara.screen.height + PAD2) * zoom);
 	}
 }
 
 /* emulator primitives */
 
 int
-emu_resize(int width, int height)
+emu_resize(UxnScreen *scr, int width, int height)
 {
 	if(!window_created)
 		return 0;
 	if(emu_texture != NULL)
 		SDL_DestroyTexture(emu_texture);
 	SDL_RenderSetLogicalSize(emu_renderer, width + PAD2, height + PAD2);
-	emu_texture = SDL_CreateTexture(emu_renderer, SDL_PIXELFORMAT_RGB888, SDL_TEXTUREACCESS_STATIC, width, height);
+	emu_texture = SDL_CreateTexture(emu_renderer, SDL_PIXELFORMAT_RGB888, SDL_TEXTUREACCESS_STREAMING, width, height);
 	if(emu_texture == NULL || SDL_SetTextureBlendMode(emu_texture, SDL_BLENDMODE_NONE))
 		return system_error("SDL_SetTextureBlendMode", SDL_GetError());
-	if(SDL_UpdateTexture(emu_texture, NULL, uxn_screen.pixels, sizeof(Uint32)) != 0)
-		return system_error("SDL_UpdateTexture", SDL_GetError());
+	/* the new texture holds nothing yet */
+	screen_change(scr, 0, 0, width, height);
 	emu_viewport.x = PAD;
 	emu_viewport.y = PAD;
-	emu_viewport.w = uxn_screen.width;
-	emu_viewport.h = uxn_screen.height;
+	emu_viewport.w = scr->width;
+	emu_viewport.h = scr->height;
 	set_window_size(emu_window, (width + PAD2) * zoom, (height + PAD2) * zoom);
 	return 1;
 }
 
+/* The screen draws the runs of tiles it redraws straight into the streaming
+texture, locked a run at a time, and the unlock uploads just that run. Should
+the lock fail, the run is drawn in scr->pixels and copied over. */
+
+Uint32 *
+emu_lock(UxnScreen *scr, int x, int y, int width, int height, int *pitch)
+{
+	SDL_Rect rect = {x, y, width, height};
+	void *pixels;
+	if(!emu_texture || SDL_LockTexture(emu_texture, &rect, &pixels, pitch) != 0)
+		return NULL;
+	*pitch /= sizeof(Uint32);
+	texture_locked = 1;
+	return pixels;
+}
+
+void
+emu_update(UxnScreen *scr, int x, int y, int width, int height)
+{
+	SDL_Rect rect = {x, y, width, height};
+	if(texture_locked) {
+		SDL_UnlockTexture(emu_texture);
+		texture_locked = 0;
+	} else if(emu_texture && SDL_UpdateTexture(emu_texture, &rect, scr->pixels + x + y * scr->width, scr->width * sizeof(Uint32)) != 0)
+		system_error("SDL_UpdateTexture", SDL_GetError());
+}
+
 static void
 emu_redraw(Uxn *u)
 {
+	UxnScreen *scr = &u->emu->screen;
 	if(u->dev[0x0e]) {
-		screen_change(0, 0, uxn_screen.width, uxn_screen.height);
-		screen_redraw();
-		screen_debugger(u);
+		screen_change(scr, 0, 0, scr->width, scr->height);
+		screen_redraw(scr);
+		screen_debugger(scr, u);
 	} else
-		screen_redraw();
-	if(SDL_UpdateTexture(emu_texture, NULL, uxn_screen.pixels, uxn_screen.width * sizeof(Uint32)) != 0)
-		system_error("SDL_UpdateTexture", SDL_GetError());
+		screen_redraw(scr);
 	SDL_RenderClear(emu_renderer);
 	SDL_RenderCopy(emu_renderer, emu_texture, NULL, &emu_viewport);
 	SDL_RenderPresent(emu_renderer);
@@ -235,7 +283,7 @@ emu_init(void)
 	as.channels = 2;
 	as.callback = audio_callback;
 	as.samples = 512;
-	as.userdata = NULL;
+	as.userdata = &varvara;
 	if(SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO | SDL_INIT_JOYSTICK) < 0)
 		return system_error("sdl", SDL_GetError());
 
@@ -252,22 +300,46 @@ emu_init(void)
 	SDL_EventState(SDL_DROPFILE, SDL_ENABLE);
 	SDL_SetRenderDrawColor(emu_renderer, 0x00, 0x00, 0x00, 0xff);
 	ms_interval = SDL_GetPerformanceFrequency() / 1000;
-	deadline_interval = ms_interval * TIMEOUT_MS;
 	return 1;
 }
 
+static void
+emu_connect(Uxn *u, Varvara *v)
+{
+	u->emu = v;
+	system_connect(u, 0x0, SYSTEM_VERSION, SYSTEM_DEIMASK, SYSTEM_DEOMASK);
+	system_connect(u, 0x1, CONSOLE_VERSION, CONSOLE_DEIMASK, CONSOLE_DEOMASK);
+	system_connect(u, 0x2, SCREEN_VERSION, SCREEN_DEIMASK, SCREEN_DEOMASK);
+	system_connect(u, 0x3, AUDIO_VERSION, AUDIO_DEIMASK, AUDIO_DEOMASK);
+	system_connect(u, 0x4, AUDIO_VERSION, AUDIO_DEIMASK, AUDIO_DEOMASK);
+	system_connect(u, 0x5, AUDIO_VERSION, AUDIO_DEIMASK, AUDIO_DEOMASK);
+	system_connect(u, 0x6, AUDIO_VERSION, AUDIO_DEIMASK, AUDIO_DEOMASK);
+	system_connect(u, 0x8, CONTROL_VERSION, CONTROL_DEIMASK, CONTROL_DEOMASK);
+	system_connect(u, 0x9, MOUSE_VERSION, MOUSE_DEIMASK, MOUSE_DEOMASK);
+	system_connect(u, 0xa, FILE_VERSION, FILE_DEIMASK, FILE_DEOMASK);
+	system_connect(u, 0xb, FILE_VERSION, FILE_DEIMASK, FILE_DEOMASK);
+	system_connect(u, 0xc, DATETIME_VERSION, DATETIME_DEIMASK, DATETIME_DEOMASK);
+}
+
 static int
 emu_start(Uxn *u, char *rom, int queue)
 {
-	free(u->ram);
-	if(!uxn_boot(u, (Uint8 *)calloc(0x10000 * RAM_PAGES, sizeof(Uint8))))
+	uxn_free(u);
+	system_ram_free(u->ram);
+	if(!uxn_boot(u, system_ram()))
 		return system_error("Boot", "Failed to start uxn.");
+	emu_connect(u, &varvara);
 	if(!system_load(u, rom))
 		return system_error("Boot", "Failed to load rom.");
 	u->dev[0x17] = queue;
-	exec_deadline = SDL_GetPerformanceCounter() + deadline_interval;
-	screen_resize(WIDTH, HEIGHT);
-	if(!uxn_eval(u, PAGE_PROGRAM))
+	screen_resize(&u->emu->screen, WIDTH, HEIGHT);
+	/* a snapshot given on the command line stands in for the reset vector */
+	if(resume_path) {
+		char *snap = resume_path;
+		resume_path = NULL;
+		if(!uxn_snapshot_load(u, snap))
+			return system_error("Boot", "Failed to load snapshot.");
+	} else if(!uxn_eval(u, PAGE_PROGRAM))
 		return system_error("Boot", "Failed to eval rom.");
 	SDL_SetWindowTitle(emu_window, rom);
 	return 1;
@@ -276,7 +348,7 @@ emu_start(Uxn *u, char *rom, int queue)
 static void
 emu_restart(Uxn *u)
 {
-	screen_resize(WIDTH, HEIGHT);
+	screen_resize(&u->emu->screen, WIDTH, HEIGHT);
 	if(!emu_start(u, "launcher.rom", 0))
 		emu_start(u, rom_path, 0);
 }
@@ -312,6 +384,18 @@ capture_screen(void)
 	SDL_FreeSurface(surface);
 }
 
+static void
+snapshot(Uxn *u, int save)
+{
+	char path[0x400];
+	snprintf(path, sizeof(path), "%s.snap", rom_path);
+	if(save ? uxn_snapshot_save(u, path) : uxn_snapshot_load(u, path))
+		fprintf(stderr, "%s %s\n", save ? "Saved" : "Loaded", path);
+	else
+		fprintf(stderr, "Failed to %s %s\n", save ? "save" : "load", path);
+	fflush(stderr);
+}
+
 static Uint8
 get_button(SDL_Event *event)
 {
@@ -360,18 +444,35 @@ get_key(SDL_Event *event)
 	return 0x00;
 }
 
+/* While a frame is carried over, its vector gets to the end before any input
+does, only the window events are taken and the rest are left queued. */
+
+static int
+poll_window_event(SDL_Event *event)
+{
+	return SDL_PeepEvents(event, 1, SDL_GETEVENT, SDL_QUIT, SDL_WINDOWEVENT) == 1 ||
+		SDL_PeepEvents(event, 1, SDL_GETEVENT, SDL_DROPFILE, SDL_DROPFILE) == 1;
+}
+
 static int
 handle_events(Uxn *u)
 {
 	SDL_Event event;
-	while(SDL_PollEvent(&event)) {
+	if(u->resume)
+		SDL_PumpEvents();
+	while(u->resume ? poll_window_event(&event) : SDL_PollEvent(&event)) {
 		/* Window */
 		if(event.type == SDL_QUIT)
 			return 0;
-		else if(event.type == SDL_WINDOWEVENT && event.window.event == SDL_WINDOWEVENT_EXPOSED)
-			emu_redraw(u);
+		else if(event.type == SDL_WINDOWEVENT && event.window.event == SDL_WINDOWEVENT_EXPOSED) {
+			/* a frame carried over is only shown once it's done */
+			if(u->resume)
+				u->emu->screen.changed = 1;
+			else
+				emu_redraw(u);
+		}
 		else if(event.type == SDL_DROPFILE) {
-			screen_resize(WIDTH, HEIGHT);
+			screen_resize(&u->emu->screen, WIDTH, HEIGHT);
 			emu_start(u, event.drop.file, 0);
 			SDL_free(event.drop.file);
 		}
@@ -380,7 +481,7 @@ handle_events(Uxn *u)
 			uxn_eval(u, PEEK2(&u->dev[0x30 + 0x10 * (event.type - audio0_event)]));
 		/* Mouse */
 		else if(event.type == SDL_MOUSEMOTION)
-			mouse_pos(u, &u->dev[0x90], clamp(event.motion.x - PAD, 0, uxn_screen.width - 1), clamp(event.motion.y - PAD, 0, uxn_screen.height - 1));
+			mouse_pos(u, &u->dev[0x90], clamp(event.motion.x - PAD, 0, u->emu->screen.width - 1), clamp(event.motion.y - PAD, 0, u->emu->screen.height - 1));
 		else if(event.type == SDL_MOUSEBUTTONUP)
 			mouse_up(u, &u->dev[0x90], SDL_BUTTON(event.button.button));
 		else if(event.type == SDL_MOUSEBUTTONDOWN)
@@ -404,6 +505,10 @@ handle_events(Uxn *u)
 				capture_screen();
 			else if(event.key.keysym.sym == SDLK_F4)
 				emu_restart(u);
+			else if(event.key.keysym.sym == SDLK_F5)
+				snapshot(u, 1);
+			else if(event.key.keysym.sym == SDLK_F6)
+				snapshot(u, 0);
 			ksym = event.key.keysym.sym;
 			if(SDL_PeepEvents(&event, 1, SDL_PEEKEVENT, SDL_KEYUP, SDL_KEYUP) == 1 && ksym == event.key.keysym.sym)
 				return 1;
@@ -462,19 +567,32 @@ handle_events(Uxn *u)
 	return 1;
 }
 
+/* The screen vector runs on a budget, a frame that runs out of it yields and
+is carried on after the events that came in meanwhile, and only then drawn. */
+
+static void
+emu_frame(Uxn *u, Uint16 pc)
+{
+	u->budget = BUDGET;
+	u->resume = 0;
+	uxn_eval(u, pc);
+	u->budget = 0;
+}
+
 static int
 run(Uxn *u, char *rom)
 {
+	UxnScreen *scr = &u->emu->screen;
 	Uint64 next_refresh = 0;
 	Uint64 frame_interval = SDL_GetPerformanceFrequency() / 60;
 	window_created = 1;
-	emu_window = SDL_CreateWindow(rom, SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, (uxn_screen.width + PAD2) * zoom, (uxn_screen.height + PAD2) * zoom, SDL_WINDOW_SHOWN | SDL_WINDOW_ALLOW_HIGHDPI);
+	emu_window = SDL_CreateWindow(rom, SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, (scr->width + PAD2) * zoom, (scr->height + PAD2) * zoom, SDL_WINDOW_SHOWN | SDL_WINDOW_ALLOW_HIGHDPI);
 	if(emu_window == NULL)
 		return system_error("sdl_window", SDL_GetError());
 	emu_renderer = SDL_CreateRenderer(emu_window, -1, SDL_RENDERER_ACCELERATED);
 	if(emu_renderer == NULL)
 		return system_error("sdl_renderer", SDL_GetError());
-	emu_resize(uxn_screen.width, uxn_screen.height);
+	emu_resize(scr, scr->width, scr->height);
 	/* game loop */
 	for(;;) {
 		Uint16 screen_vector;
@@ -482,18 +600,23 @@ run(Uxn *u, char *rom)
 		/* .System/halt */
 		if(u->dev[0x0f])
 			return system_error("Run", "Ended.");
-		exec_deadline = now + deadline_interval;
 		if(!handle_events(u))
 			return 0;
 		screen_vector = PEEK2(&u->dev[0x20]);
-		if(now >= next_refresh) {
-			now = SDL_GetPerformanceCounter();
-			next_refresh = now + frame_interval;
-			uxn_eval(u, screen_vector);
-			if(uxn_screen.x2)
+		if(u->resume || now >= next_refresh) {
+			if(u->resume)
+				emu_frame(u, u->resume);
+			else {
+				now = SDL_GetPerformanceCounter();
+				next_refresh = now + frame_interval;
+				emu_frame(u, screen_vector);
+			}
+			if(u->resume)
+				continue;
+			if(scr->changed)
 				emu_redraw(u);
 		}
-		if(screen_vector || uxn_screen.x2) {
+		if(screen_vector || scr->changed) {
 			Uint64 delay_ms = (next_refresh - now) / ms_interval;
 			if(delay_ms > 0) SDL_Delay(delay_ms);
 		} else
@@ -506,26 +629,28 @@ main(int argc, char **argv)
 {
 	Uxn u = {0};
 	int i = 1;
+	char *stacks = NULL;
 	if(i == argc)
-		return system_error("usage", "uxnemu [-v][-2x][-3x] file.rom [args...]");
+		return system_error("usage", "uxnemu [-v][-2x][-3x][-r file.snap] file.rom [args...]");
 	/* Connect Varvara */
-	system_connect(0x0, SYSTEM_VERSION, SYSTEM_DEIMASK, SYSTEM_DEOMASK);
-	system_connect(0x1, CONSOLE_VERSION, CONSOLE_DEIMASK, CONSOLE_DEOMASK);
-	system_connect(0x2, SCREEN_VERSION, SCREEN_DEIMASK, SCREEN_DEOMASK);
-	system_connect(0x3, AUDIO_VERSION, AUDIO_DEIMASK, AUDIO_DEOMASK);
-	system_connect(0x4, AUDIO_VERSION, AUDIO_DEIMASK, AUDIO_DEOMASK);
-	system_connect(0x5, AUDIO_VERSION, AUDIO_DEIMASK, AUDIO_DEOMASK);
-	system_connect(0x6, AUDIO_VERSION, AUDIO_DEIMASK, AUDIO_DEOMASK);
-	system_connect(0x8, CONTROL_VERSION, CONTROL_DEIMASK, CONTROL_DEOMASK);
-	system_connect(0x9, MOUSE_VERSION, MOUSE_DEIMASK, MOUSE_DEOMASK);
-	system_connect(0xa, FILE_VERSION, FILE_DEIMASK, FILE_DEOMASK);
-	system_connect(0xb, FILE_VERSION, FILE_DEIMASK, FILE_DEOMASK);
-	system_connect(0xc, DATETIME_VERSION, DATETIME_DEIMASK, DATETIME_DEOMASK);
+	emu_connect(&u, &varvara);
+	varvara.out = stdout;
+	varvara.err = stderr;
 	/* Read flags */
 	if(argv[i][0] == '-' && argv[i][1] == 'v')
-		return system_version("Uxnemu - Graphical Varvara Emulator", "8 Aug 2023");
+		return system_version(&u, "Uxnemu - Graphical Varvara Emulator", "8 Aug 2023");
 	if(strcmp(argv[i], "-2x") == 0 || strcmp(argv[i], "-3x") == 0)
 		set_zoom(argv[i++][1] - '0', 0);
+	if(i + 2 < argc && strcmp(argv[i], "-r") == 0) {
+		resume_path = argv[i + 1];
+		i += 2;
+	}
+#ifdef UXN_PROFILE
+	if(i + 2 < argc && strcmp(argv[i], "-p") == 0) {
+		stacks = argv[i + 1];
+		i += 2;
+	}
+#endif
 	/* Continue.. */
 	if(!emu_init())
 		return system_error("Init", "Failed to initialize emulator.");
@@ -533,6 +658,9 @@ main(int argc, char **argv)
 
 	/* load rom */
 	rom_path = argv[i++];
+#ifdef UXN_PROFILE
+	profile_load(rom_path);
+#endif
 	if(!emu_start(&u, rom_path, argc - i))
 		return system_error("Start", "Failed");
 	/* read arguments */
@@ -551,5 +679,12 @@ main(int argc, char **argv)
 	close(0); /* make stdin thread exit */
 #endif
 	SDL_Quit();
+#ifdef UXN_PROFILE
+	profile_report();
+	if(stacks && !profile_save(stacks))
+		system_error("Profile", "Failed to save.");
+#else
+	USED(stacks);
+#endif
 	return 0;
 }
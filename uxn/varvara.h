@@ -0,0 +1,10 @@
+/* The devices of one Varvara machine. Each Uxn points at its own in u->emu,
+so that a process can run as many machines as it likes, on as many threads.
+Include it after the headers of the devices. */
+
+typedef struct Varvara {
+	UxnScreen screen;
+	UxnAudio audio[POLYPHONY];
+	UxnFile file[POLYFILEY];
+	FILE *out, *err; /* where the console writes, and the system device its reports */
+} Varvara;